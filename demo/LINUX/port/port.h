@@ -68,6 +68,8 @@ void            vMBPortLog( eMBPortLogLevel eLevel, const CHAR * szModule,
 void            vMBPortTimerPoll(  );
 BOOL            xMBPortSerialPoll(  );
 BOOL            xMBPortSerialSetTimeout( ULONG dwTimeoutMs );
+BOOL            xMBPortExecInit( USHORT usNThreads );
+void            vMBPortExecClose( void );
 
 #ifdef __cplusplus
 PR_END_EXTERN_C
@@ -0,0 +1,425 @@
+/*
+ * FreeModbus Libary: Linux Port
+ * Copyright (C) 2006 Christian Walter <wolti@sil.at>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * File: $Id$
+ */
+
+/* ----------------------- Standard includes --------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbutils.h"
+#include "portshm.h"
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_SHM_MAGIC                ( 0x4D425348UL )
+#define MB_SHM_ALIGN( xSize )       ( ( ( xSize ) + 7 ) & ~( size_t )7 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    ULONG           ulTable;
+    ULONG           ulAddress;
+    ULONG           ulNRegs;
+    ULONG           ulOffset;       /* Offset of the data in the segment. */
+    volatile ULONG  ulSequence;     /* Odd while a writer is active. */
+    volatile ULONG  ulLock;         /* Serializes the writers. */
+} xMBShmRangeHeader;
+
+struct xMBShmHeaderStruct
+{
+    volatile ULONG  ulMagic;        /* Set after the segment is initialized. */
+    ULONG           ulSize;
+    volatile unsigned int uiChange; /* The futex. */
+    volatile unsigned int uiWaiters;
+    ULONG           ulNRanges;
+    xMBShmRangeHeader xRanges[MB_SHM_RANGES_MAX];
+};
+
+/* ----------------------- Static functions ---------------------------------*/
+static size_t   prvxMBShmRangeSize( const xMBShmRange * pxRange );
+static xMBShmRangeHeader *prvpxMBShmFind( xMBShm * pxShm, eMBShmTable eTable, USHORT usAddress );
+static void     prvvMBShmCopy( xMBShm * pxShm, xMBShmRangeHeader * pxRange, UCHAR * pucRegBuffer,
+                               USHORT usBufOffset, USHORT usOffset, USHORT usN, eMBRegisterMode eMode );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBShmOpen( xMBShm * pxShm, const CHAR * pszName, const xMBShmRange * pxRanges, USHORT usNRanges,
+            BOOL xCreate )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    xMBShmHeader   *pxHeader = NULL;
+    size_t          xSize = MB_SHM_ALIGN( sizeof( xMBShmHeader ) );
+    struct stat     xStat;
+    USHORT          usIdx;
+    USHORT          usOther;
+    int             iFd = -1;
+
+    pxShm->pxHeader = NULL;
+    if( ( usNRanges == 0 ) || ( usNRanges > MB_SHM_RANGES_MAX ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    for( usIdx = 0; ( eStatus == MB_ENOERR ) && ( usIdx < usNRanges ); usIdx++ )
+    {
+        if( ( pxRanges[usIdx].eTable > MB_SHM_DISCRETE ) || ( pxRanges[usIdx].usAddress == 0 ) ||
+            ( pxRanges[usIdx].usNRegs == 0 ) ||
+            ( ( ( ULONG )pxRanges[usIdx].usAddress + pxRanges[usIdx].usNRegs ) > 0x10000UL ) )
+        {
+            eStatus = MB_EINVAL;
+        }
+        for( usOther = 0; ( eStatus == MB_ENOERR ) && ( usOther < usIdx ); usOther++ )
+        {
+            if( ( pxRanges[usOther].eTable == pxRanges[usIdx].eTable ) &&
+                ( pxRanges[usOther].usAddress < pxRanges[usIdx].usAddress + pxRanges[usIdx].usNRegs ) &&
+                ( pxRanges[usIdx].usAddress < pxRanges[usOther].usAddress + pxRanges[usOther].usNRegs ) )
+            {
+                eStatus = MB_EINVAL;
+            }
+        }
+        xSize += prvxMBShmRangeSize( &pxRanges[usIdx] );
+    }
+
+    if( eStatus == MB_ENOERR )
+    {
+        iFd = shm_open( pszName, xCreate ? ( O_RDWR | O_CREAT | O_TRUNC ) : O_RDWR, 0660 );
+        if( ( iFd == -1 ) ||
+            ( xCreate && ( ftruncate( iFd, ( off_t )xSize ) == -1 ) ) ||
+            ( fstat( iFd, &xStat ) == -1 ) || ( ( size_t )xStat.st_size != xSize ) )
+        {
+            eStatus = MB_EPORTERR;
+        }
+        else if( ( pxHeader = mmap( NULL, xSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0 ) ) == MAP_FAILED )
+        {
+            pxHeader = NULL;
+            eStatus = MB_EPORTERR;
+        }
+        if( iFd != -1 )
+        {
+            ( void )close( iFd );
+        }
+    }
+
+    if( ( eStatus == MB_ENOERR ) && xCreate )
+    {
+        /* ftruncate( ) has zeroed the segment. */
+        pxHeader->ulSize = ( ULONG )xSize;
+        pxHeader->ulNRanges = usNRanges;
+        xSize = MB_SHM_ALIGN( sizeof( xMBShmHeader ) );
+        for( usIdx = 0; usIdx < usNRanges; usIdx++ )
+        {
+            pxHeader->xRanges[usIdx].ulTable = ( ULONG )pxRanges[usIdx].eTable;
+            pxHeader->xRanges[usIdx].ulAddress = pxRanges[usIdx].usAddress;
+            pxHeader->xRanges[usIdx].ulNRegs = pxRanges[usIdx].usNRegs;
+            pxHeader->xRanges[usIdx].ulOffset = ( ULONG )xSize;
+            xSize += prvxMBShmRangeSize( &pxRanges[usIdx] );
+        }
+        __atomic_store_n( &pxHeader->ulMagic, MB_SHM_MAGIC, __ATOMIC_RELEASE );
+    }
+    else if( eStatus == MB_ENOERR )
+    {
+        /* The layout must match the layout of the creator. */
+        if( ( __atomic_load_n( &pxHeader->ulMagic, __ATOMIC_ACQUIRE ) != MB_SHM_MAGIC ) ||
+            ( pxHeader->ulNRanges != usNRanges ) )
+        {
+            eStatus = MB_EINVAL;
+        }
+        for( usIdx = 0; ( eStatus == MB_ENOERR ) && ( usIdx < usNRanges ); usIdx++ )
+        {
+            if( ( pxHeader->xRanges[usIdx].ulTable != ( ULONG )pxRanges[usIdx].eTable ) ||
+                ( pxHeader->xRanges[usIdx].ulAddress != pxRanges[usIdx].usAddress ) ||
+                ( pxHeader->xRanges[usIdx].ulNRegs != pxRanges[usIdx].usNRegs ) )
+            {
+                eStatus = MB_EINVAL;
+            }
+        }
+    }
+
+    if( eStatus == MB_ENOERR )
+    {
+        pxShm->pxHeader = pxHeader;
+        pxShm->xSize = xSize;
+    }
+    else if( pxHeader != NULL )
+    {
+        ( void )munmap( pxHeader, xSize );
+    }
+    return eStatus;
+}
+
+void
+vMBShmClose( xMBShm * pxShm )
+{
+    if( pxShm->pxHeader != NULL )
+    {
+        ( void )munmap( pxShm->pxHeader, pxShm->xSize );
+        pxShm->pxHeader = NULL;
+    }
+}
+
+eMBErrorCode
+eMBShmUnlink( const CHAR * pszName )
+{
+    return shm_unlink( pszName ) == 0 ? MB_ENOERR : MB_EPORTERR;
+}
+
+void           *
+pvMBShmData( xMBShm * pxShm, USHORT usRange )
+{
+    return ( UCHAR * ) pxShm->pxHeader + pxShm->pxHeader->xRanges[usRange].ulOffset;
+}
+
+void
+vMBShmBeginWrite( xMBShm * pxShm, USHORT usRange )
+{
+    xMBShmRangeHeader *pxRange = &pxShm->pxHeader->xRanges[usRange];
+
+    while( __atomic_exchange_n( &pxRange->ulLock, 1, __ATOMIC_ACQUIRE ) != 0 )
+    {
+    }
+    __atomic_store_n( &pxRange->ulSequence, pxRange->ulSequence + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+void
+vMBShmEndWrite( xMBShm * pxShm, USHORT usRange )
+{
+    xMBShmRangeHeader *pxRange = &pxShm->pxHeader->xRanges[usRange];
+
+    __atomic_store_n( &pxRange->ulSequence, pxRange->ulSequence + 1, __ATOMIC_RELEASE );
+    __atomic_store_n( &pxRange->ulLock, 0, __ATOMIC_RELEASE );
+
+    /* Together with eMBShmWaitChange( ) either the waiter sees the new
+     * change counter or we see the waiter. */
+    ( void )__atomic_fetch_add( &pxShm->pxHeader->uiChange, 1, __ATOMIC_SEQ_CST );
+    if( __atomic_load_n( &pxShm->pxHeader->uiWaiters, __ATOMIC_SEQ_CST ) > 0 )
+    {
+        ( void )syscall( SYS_futex, &pxShm->pxHeader->uiChange, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+    }
+}
+
+eMBErrorCode
+eMBShmWaitChange( xMBShm * pxShm, unsigned int *puiSeen, LONG lTimeoutMs )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    xMBShmHeader   *pxHeader = pxShm->pxHeader;
+    struct timespec xNow, xDeadline, xRemaining;
+    unsigned int    uiChange;
+
+    ( void )clock_gettime( CLOCK_MONOTONIC, &xDeadline );
+    xDeadline.tv_sec += lTimeoutMs / 1000;
+    xDeadline.tv_nsec += ( lTimeoutMs % 1000 ) * 1000000L;
+    if( xDeadline.tv_nsec >= 1000000000L )
+    {
+        xDeadline.tv_sec++;
+        xDeadline.tv_nsec -= 1000000000L;
+    }
+
+    ( void )__atomic_fetch_add( &pxHeader->uiWaiters, 1, __ATOMIC_SEQ_CST );
+    while( ( ( uiChange = __atomic_load_n( &pxHeader->uiChange, __ATOMIC_SEQ_CST ) ) == *puiSeen ) &&
+           ( eStatus == MB_ENOERR ) )
+    {
+        ( void )clock_gettime( CLOCK_MONOTONIC, &xNow );
+        xRemaining.tv_sec = xDeadline.tv_sec - xNow.tv_sec;
+        xRemaining.tv_nsec = xDeadline.tv_nsec - xNow.tv_nsec;
+        if( xRemaining.tv_nsec < 0 )
+        {
+            xRemaining.tv_sec--;
+            xRemaining.tv_nsec += 1000000000L;
+        }
+        if( ( lTimeoutMs >= 0 ) && ( xRemaining.tv_sec < 0 ) )
+        {
+            eStatus = MB_ETIMEDOUT;
+        }
+        else
+        {
+            /* Returns immediately if the counter has already changed. */
+            ( void )syscall( SYS_futex, &pxHeader->uiChange, FUTEX_WAIT, *puiSeen,
+                             lTimeoutMs >= 0 ? &xRemaining : NULL, NULL, 0 );
+        }
+    }
+    ( void )__atomic_fetch_sub( &pxHeader->uiWaiters, 1, __ATOMIC_SEQ_CST );
+    *puiSeen = uiChange;
+    return eStatus;
+}
+
+eMBErrorCode
+eMBShmAccess( xMBShm * pxShm, eMBShmTable eTable, UCHAR * pucRegBuffer, USHORT usAddress,
+              USHORT usNRegs, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    xMBShmRangeHeader *pxRange;
+    USHORT          usDone;
+    USHORT          usCur;
+    USHORT          usOffset;
+    USHORT          usN = 0;
+    USHORT          usRetries;
+    ULONG           ulBefore;
+    ULONG           ulAfter;
+
+    /* Check that the whole request is mapped before anything is copied. */
+    for( usDone = 0; ( eStatus == MB_ENOERR ) && ( usDone < usNRegs ); usDone += usN )
+    {
+        usCur = ( USHORT )( usAddress + usDone );
+        if( ( pxRange = prvpxMBShmFind( pxShm, eTable, usCur ) ) == NULL )
+        {
+            eStatus = MB_ENOREG;
+        }
+        else
+        {
+            usN = ( USHORT )( pxRange->ulAddress + pxRange->ulNRegs - usCur );
+            if( usN > ( usNRegs - usDone ) )
+            {
+                usN = ( USHORT )( usNRegs - usDone );
+            }
+        }
+    }
+
+    if( ( eStatus == MB_ENOERR ) && ( eMode == MB_REG_READ ) &&
+        ( ( eTable == MB_SHM_COILS ) || ( eTable == MB_SHM_DISCRETE ) ) )
+    {
+        memset( pucRegBuffer, 0, ( size_t )( ( usNRegs + 7 ) / 8 ) );
+    }
+
+    for( usDone = 0; ( eStatus == MB_ENOERR ) && ( usDone < usNRegs ); usDone += usN )
+    {
+        usCur = ( USHORT )( usAddress + usDone );
+        pxRange = prvpxMBShmFind( pxShm, eTable, usCur );
+        usOffset = ( USHORT )( usCur - pxRange->ulAddress );
+        usN = ( USHORT )( pxRange->ulNRegs - usOffset );
+        if( usN > ( usNRegs - usDone ) )
+        {
+            usN = ( USHORT )( usNRegs - usDone );
+        }
+
+        if( eMode == MB_REG_WRITE )
+        {
+            vMBShmBeginWrite( pxShm, ( USHORT )( pxRange - pxShm->pxHeader->xRanges ) );
+            prvvMBShmCopy( pxShm, pxRange, pucRegBuffer, usDone, usOffset, usN, eMode );
+            vMBShmEndWrite( pxShm, ( USHORT )( pxRange - pxShm->pxHeader->xRanges ) );
+        }
+        else
+        {
+            usRetries = 0;
+            do
+            {
+                ulBefore = __atomic_load_n( &pxRange->ulSequence, __ATOMIC_ACQUIRE );
+                if( ( ulBefore & 1 ) == 0 )
+                {
+                    prvvMBShmCopy( pxShm, pxRange, pucRegBuffer, usDone, usOffset, usN, eMode );
+                    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+                    ulAfter = __atomic_load_n( &pxRange->ulSequence, __ATOMIC_RELAXED );
+                }
+                else
+                {
+                    ulAfter = ulBefore + 1;
+                }
+                usRetries++;
+            }
+            while( ( ulBefore != ulAfter ) && ( usRetries < MB_SHM_READ_RETRIES ) );
+
+            if( ulBefore != ulAfter )
+            {
+                eStatus = MB_ETIMEDOUT;
+            }
+        }
+    }
+    return eStatus;
+}
+
+static          size_t
+prvxMBShmRangeSize( const xMBShmRange * pxRange )
+{
+    size_t          xSize = pxRange->usNRegs;
+
+    if( ( pxRange->eTable == MB_SHM_HOLDING ) || ( pxRange->eTable == MB_SHM_INPUT ) )
+    {
+        xSize *= sizeof( USHORT );
+    }
+    return MB_SHM_ALIGN( xSize );
+}
+
+static xMBShmRangeHeader *
+prvpxMBShmFind( xMBShm * pxShm, eMBShmTable eTable, USHORT usAddress )
+{
+    xMBShmRangeHeader *pxRange = NULL;
+    ULONG           ulIdx;
+
+    for( ulIdx = 0; ( pxRange == NULL ) && ( ulIdx < pxShm->pxHeader->ulNRanges ); ulIdx++ )
+    {
+        if( ( pxShm->pxHeader->xRanges[ulIdx].ulTable == ( ULONG )eTable ) &&
+            ( usAddress >= pxShm->pxHeader->xRanges[ulIdx].ulAddress ) &&
+            ( usAddress < pxShm->pxHeader->xRanges[ulIdx].ulAddress + pxShm->pxHeader->xRanges[ulIdx].ulNRegs ) )
+        {
+            pxRange = &pxShm->pxHeader->xRanges[ulIdx];
+        }
+    }
+    return pxRange;
+}
+
+static void
+prvvMBShmCopy( xMBShm * pxShm, xMBShmRangeHeader * pxRange, UCHAR * pucRegBuffer,
+               USHORT usBufOffset, USHORT usOffset, USHORT usN, eMBRegisterMode eMode )
+{
+    UCHAR          *pucData = ( UCHAR * ) pxShm->pxHeader + pxRange->ulOffset;
+    USHORT          usIdx;
+    UCHAR           ucMask;
+
+    if( ( pxRange->ulTable == MB_SHM_HOLDING ) || ( pxRange->ulTable == MB_SHM_INPUT ) )
+    {
+        if( eMode == MB_REG_READ )
+        {
+            vMBUtilCopyRegsToPDU( &pucRegBuffer[usBufOffset * 2], ( USHORT * ) pucData + usOffset, usN );
+        }
+        else
+        {
+            vMBUtilCopyRegsFromPDU( ( USHORT * ) pucData + usOffset, &pucRegBuffer[usBufOffset * 2], usN );
+        }
+    }
+    else
+    {
+        pucData += usOffset;
+        for( usIdx = usBufOffset; usIdx < usBufOffset + usN; usIdx++ )
+        {
+            ucMask = ( UCHAR )( 1 << ( usIdx % 8 ) );
+            if( eMode == MB_REG_READ )
+            {
+                /* Set or clear, so a retried snapshot overwrites the bit. */
+                pucRegBuffer[usIdx / 8] = ( UCHAR )( ( pucRegBuffer[usIdx / 8] & ~ucMask ) |
+                                                     ( *pucData++ ? ucMask : 0 ) );
+            }
+            else
+            {
+                *pucData++ = ( pucRegBuffer[usIdx / 8] & ucMask ) ? 1 : 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * FreeModbus Libary: Linux Port
+ * Copyright (C) 2006 Christian Walter <wolti@sil.at>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * File: $Id$
+ */
+
+#ifndef _PORT_SHM_H
+#define _PORT_SHM_H
+
+#include "port.h"
+#include "mb.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/* ----------------------- Defines ------------------------------------------*/
+/* Registers, coils and discrete inputs can be kept in a POSIX shared
+ * memory segment. Another process, e.g. the control logic, updates the
+ * values with plain stores between vMBShmBeginWrite( ) and vMBShmEndWrite( ).
+ * Each range has a sequence counter, so requests served from the segment
+ * always see a consistent snapshot of a range. Every completed write,
+ * including writes by the master, increments a change counter which can be
+ * waited for with eMBShmWaitChange( ). The waiting is done with a futex, so
+ * no system call is made if nobody waits.
+ *
+ * Registers are stored as native USHORT values. Coils and discrete inputs
+ * are stored as one UCHAR per bit which is either 0 or 1. All processes
+ * must pass the same ranges to eMBShmOpen( ) and must use the same ABI.
+ *
+ * The application serves the requests by calling eMBShmAccess( ) from its
+ * register callbacks, e.g.
+ *
+ *   eMBErrorCode
+ *   eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs,
+ *                    eMBRegisterMode eMode )
+ *   {
+ *       return eMBShmAccess( &xShm, MB_SHM_HOLDING, pucRegBuffer, usAddress,
+ *                            usNRegs, eMode );
+ *   }
+ */
+#define MB_SHM_RANGES_MAX           ( 32 )
+
+/* Number of attempts to take a snapshot before MB_ETIMEDOUT is returned. */
+#define MB_SHM_READ_RETRIES         ( 1000 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef enum
+{
+    MB_SHM_HOLDING,
+    MB_SHM_INPUT,
+    MB_SHM_COILS,
+    MB_SHM_DISCRETE
+} eMBShmTable;
+
+typedef struct
+{
+    eMBShmTable     eTable;
+    USHORT          usAddress;      /* First address as passed to the callbacks. */
+    USHORT          usNRegs;        /* Number of registers or bits. */
+} xMBShmRange;
+
+typedef struct xMBShmHeaderStruct xMBShmHeader;
+
+typedef struct
+{
+    xMBShmHeader   *pxHeader;
+    size_t          xSize;
+} xMBShm;
+
+/* ----------------------- Function prototypes ------------------------------*/
+eMBErrorCode    eMBShmOpen( xMBShm * pxShm, const CHAR * pszName,
+                            const xMBShmRange * pxRanges, USHORT usNRanges,
+                            BOOL xCreate );
+void            vMBShmClose( xMBShm * pxShm );
+eMBErrorCode    eMBShmUnlink( const CHAR * pszName );
+
+void           *pvMBShmData( xMBShm * pxShm, USHORT usRange );
+void            vMBShmBeginWrite( xMBShm * pxShm, USHORT usRange );
+void            vMBShmEndWrite( xMBShm * pxShm, USHORT usRange );
+eMBErrorCode    eMBShmWaitChange( xMBShm * pxShm, unsigned int *puiSeen,
+                                  LONG lTimeoutMs );
+
+eMBErrorCode    eMBShmAccess( xMBShm * pxShm, eMBShmTable eTable,
+                              UCHAR * pucRegBuffer, USHORT usAddress,
+                              USHORT usNRegs, eMBRegisterMode eMode );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -22,6 +22,7 @@
 /* ----------------------- Standard includes --------------------------------*/
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "port.h"
 
@@ -95,3 +96,13 @@ vMBPortTimersDisable(  )
 {
     bTimeoutEnable = FALSE;
 }
+
+ULONG
+ulMBPortGetTimestampUs(  )
+{
+    struct timespec xTimeCur;
+
+    /* The monotonic clock is not affected by changes of the system time. */
+    ( void )clock_gettime( CLOCK_MONOTONIC, &xTimeCur );
+    return ( ULONG )( ( ULONG )xTimeCur.tv_sec * 1000000UL + ( ULONG )( xTimeCur.tv_nsec / 1000 ) );
+}
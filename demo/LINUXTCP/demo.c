@@ -37,6 +37,7 @@
 /* ----------------------- Modbus includes ----------------------------------*/
 #include "mb.h"
 #include "mbport.h"
+#include "mbconfig.h"
 
 /* ----------------------- Defines ------------------------------------------*/
 #define PROG            "freemodbus"
@@ -45,6 +46,7 @@
 #define REG_INPUT_NREGS 4
 #define REG_HOLDING_START 2000
 #define REG_HOLDING_NREGS 130
+#define EXEC_THREADS    4
 
 /* ----------------------- Static variables ---------------------------------*/
 static USHORT   usRegInputStart = REG_INPUT_START;
@@ -78,6 +80,14 @@ main( int argc, char *argv[] )
         fprintf( stderr, "%s: can't initialize modbus stack!\r\n", PROG );
         iExitCode = EXIT_FAILURE;
     }
+#if MB_EXEC_ENABLED > 0
+    else if( xMBPortExecInit( EXEC_THREADS ) != TRUE )
+    {
+        fprintf( stderr, "%s: can't start worker threads!\r\n", PROG );
+        ( void )eMBClose(  );
+        iExitCode = EXIT_FAILURE;
+    }
+#endif
     else
     {
         eSetPollingThreadState( STOPPED );
@@ -144,6 +154,9 @@ main( int argc, char *argv[] )
 
         /* Release hardware resources. */
         ( void )eMBClose(  );
+#if MB_EXEC_ENABLED > 0
+        vMBPortExecClose(  );
+#endif
         iExitCode = EXIT_SUCCESS;
     }
     return iExitCode;
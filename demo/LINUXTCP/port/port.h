@@ -74,6 +74,10 @@ typedef enum
 
 void            TcpvMBPortLog( eMBPortLogLevel eLevel, const CHAR * szModule, const CHAR * szFmt,
                                ... );
+void            vMBPortLog( eMBPortLogLevel eLevel, const CHAR * szModule,
+                            const CHAR * szFmt, ... );
+BOOL            xMBPortExecInit( USHORT usNThreads );
+void            vMBPortExecClose( void );
 
 #ifdef __cplusplus
 PR_END_EXTERN_C
@@ -0,0 +1,147 @@
+/*
+ * FreeModbus Libary: Linux TCP Port
+ * Copyright (C) 2006 Christian Walter <wolti@sil.at>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * File: $Id$
+ */
+
+/* ----------------------- Standard includes --------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbport.h"
+#include "mbconfig.h"
+#include "mbexec.h"
+
+#if MB_EXEC_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PORT_EXEC_THREADS_MAX    ( 32 )
+
+/* ----------------------- Static variables ---------------------------------*/
+static pthread_mutex_t xExecLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xExecCond = PTHREAD_COND_INITIALIZER;
+static pthread_t xExecThreads[MB_PORT_EXEC_THREADS_MAX];
+static USHORT   usExecThreads;
+static BOOL     bExecShutdown;
+
+/* Never more than MB_EXEC_JOBS jobs are submitted at the same time. */
+static void    *pvExecQueue[MB_EXEC_JOBS];
+static USHORT   usExecHead;
+static USHORT   usExecCount;
+
+/* ----------------------- Static functions ---------------------------------*/
+static void    *prvpvMBPortExecWorker( void *pvArg );
+
+/* ----------------------- Start implementation -----------------------------*/
+BOOL
+xMBPortExecInit( USHORT usNThreads )
+{
+    BOOL            bOkay = TRUE;
+    int             iRes;
+
+    if( ( usExecThreads != 0 ) || ( usNThreads == 0 ) || ( usNThreads > MB_PORT_EXEC_THREADS_MAX ) )
+    {
+        bOkay = FALSE;
+    }
+    else
+    {
+        bExecShutdown = FALSE;
+        for( ; usExecThreads < usNThreads; usExecThreads++ )
+        {
+            if( ( iRes = pthread_create( &xExecThreads[usExecThreads], NULL, prvpvMBPortExecWorker, NULL ) ) != 0 )
+            {
+                vMBPortLog( MB_LOG_ERROR, "EXEC", "Can't create worker thread: %s\n", strerror( iRes ) );
+                bOkay = FALSE;
+                break;
+            }
+        }
+        if( !bOkay )
+        {
+            vMBPortExecClose(  );
+        }
+    }
+    return bOkay;
+}
+
+void
+vMBPortExecClose( void )
+{
+    USHORT          usIdx;
+
+    pthread_mutex_lock( &xExecLock );
+    bExecShutdown = TRUE;
+    pthread_cond_broadcast( &xExecCond );
+    pthread_mutex_unlock( &xExecLock );
+    for( usIdx = 0; usIdx < usExecThreads; usIdx++ )
+    {
+        ( void )pthread_join( xExecThreads[usIdx], NULL );
+    }
+    usExecThreads = 0;
+}
+
+BOOL
+xMBPortExecSubmit( void *pvJob )
+{
+    BOOL            bQueued = FALSE;
+
+    pthread_mutex_lock( &xExecLock );
+    if( ( usExecThreads != 0 ) && !bExecShutdown && ( usExecCount < MB_EXEC_JOBS ) )
+    {
+        pvExecQueue[( usExecHead + usExecCount ) % MB_EXEC_JOBS] = pvJob;
+        usExecCount++;
+        pthread_cond_signal( &xExecCond );
+        bQueued = TRUE;
+    }
+    pthread_mutex_unlock( &xExecLock );
+    return bQueued;
+}
+
+static void    *
+prvpvMBPortExecWorker( void *pvArg )
+{
+    void           *pvJob;
+
+    ( void )pvArg;
+    pthread_mutex_lock( &xExecLock );
+    while( !bExecShutdown )
+    {
+        if( usExecCount == 0 )
+        {
+            pthread_cond_wait( &xExecCond, &xExecLock );
+        }
+        else
+        {
+            pvJob = pvExecQueue[usExecHead];
+            usExecHead = ( USHORT )( ( usExecHead + 1 ) % MB_EXEC_JOBS );
+            usExecCount--;
+            pthread_mutex_unlock( &xExecLock );
+            vMBExecRun( pvJob );
+            pthread_mutex_lock( &xExecLock );
+        }
+    }
+    pthread_mutex_unlock( &xExecLock );
+    return NULL;
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "port.h"
 
@@ -67,3 +68,13 @@ vMBPortLog( eMBPortLogLevel eLevel, const CHAR * szModule, const CHAR * szFmt, .
     fprintf( stderr, szFmt, args );
     va_end( args );
 }
+
+ULONG
+ulMBPortGetTimestampUs(  )
+{
+    struct timespec xTimeCur;
+
+    /* The monotonic clock is not affected by changes of the system time. */
+    ( void )clock_gettime( CLOCK_MONOTONIC, &xTimeCur );
+    return ( ULONG )( ( ULONG )xTimeCur.tv_sec * 1000000UL + ( ULONG )( xTimeCur.tv_nsec / 1000 ) );
+}
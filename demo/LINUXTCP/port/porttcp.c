@@ -50,6 +50,8 @@
 /* ----------------------- Modbus includes ----------------------------------*/
 #include "mb.h"
 #include "mbport.h"
+#include "mbconfig.h"
+#include "mbexec.h"
 
 
 
@@ -214,7 +216,8 @@ xMBPortTCPPool( void )
         if( ( ( ret = select( xClientSocket + 1, &fread, NULL, NULL, &tval ) ) == SOCKET_ERROR )
             || !ret )
         {
-            continue;
+            /* Return to eMBPoll( ) which sends the finished responses. */
+            return FALSE;
         }
         if( ret > 0 )
         {
@@ -226,6 +229,9 @@ xMBPortTCPPool( void )
                 {
                     close( xClientSocket );
                     xClientSocket = INVALID_SOCKET;
+#if MB_EXEC_ENABLED > 0
+                    vMBExecFlush(  );
+#endif
                     return TRUE;
                 }
                 usTCPBufPos += ret;
@@ -337,6 +343,10 @@ prvvMBPortReleaseClient(  )
 
     ( void )close( xClientSocket );
     xClientSocket = INVALID_SOCKET;
+#if MB_EXEC_ENABLED > 0
+    /* The responses belong to the old connection. */
+    vMBExecFlush(  );
+#endif
 }
 
 BOOL
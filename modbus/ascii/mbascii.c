@@ -42,6 +42,8 @@
 
 #include "mbcrc.h"
 #include "mbport.h"
+#include "mbstats.h"
+#include "mbdiag.h"
 
 #if MB_ASCII_ENABLED > 0
 
@@ -173,6 +175,8 @@ eMBASCIIReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
     }
     else
     {
+        MB_STATS_INC( ulChecksumErrors );
+        MB_DIAG_INC( MB_DIAG_CNT_BUS_COMM_ERROR );
         eStatus = MB_EIO;
     }
     EXIT_CRITICAL_SECTION(  );
@@ -202,7 +206,7 @@ eMBASCIISend( UCHAR ucSlaveAddress, const UCHAR * pucFrame, USHORT usLength )
 
         /* Calculate LRC checksum for Modbus-Serial-Line-PDU. */
         usLRC = prvucMBLRC( ( UCHAR * ) pucSndBufferCur, usSndBufferCount );
-        ucASCIIBuf[usSndBufferCount++] = usLRC;
+        pucSndBufferCur[usSndBufferCount++] = usLRC;
 
         /* Activate the transmitter. */
         eSndState = STATE_TX_START;
@@ -264,6 +268,8 @@ xMBASCIIReceiveFSM( void )
                 {
                     /* not handled in Modbus specification but seems
                      * a resonable implementation. */
+                    MB_STATS_INC( ulOverruns );
+                    MB_DIAG_INC( MB_DIAG_CNT_BUS_CHAR_OVERRUN );
                     eRcvState = STATE_RX_IDLE;
                     /* Disable previously activated timer because of error state. */
                     vMBPortTimersDisable(  );
@@ -0,0 +1,223 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbutils.h"
+#include "mbfilemap.h"
+
+#if MB_FUNC_FILE_MAP_ENABLED > 0
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBFileMap *pxMBFileMaps[MB_FUNC_FILE_MAP_MAX];
+
+/* ----------------------- Static functions ---------------------------------*/
+static xMBFileMap *prvpxMBFileMapFind( xMBFileRequest * pxRequest, ULONG * pulOffset );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBFileMapRegister( xMBFileMap * pxMap, USHORT usFileNumber, void *pvData,
+                    ULONG ulLength, UCHAR ucFlags, pxMBFileMapSync pxSync )
+{
+    eMBErrorCode    eStatus = MB_ENORES;
+    USHORT          usIdx;
+
+    if( ( pvData == NULL ) || ( ulLength < 2 ) ||
+        ( ( ucFlags & ( MB_FILE_MAP_READ | MB_FILE_MAP_WRITE ) ) == 0 ) ||
+        ( ( ( ucFlags & MB_FILE_MAP_BIG_ENDIAN ) == 0 ) && ( ( ( size_t )pvData & 1 ) != 0 ) ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        for( usIdx = 0; usIdx < MB_FUNC_FILE_MAP_MAX; usIdx++ )
+        {
+            if( ( pxMBFileMaps[usIdx] == NULL ) || ( pxMBFileMaps[usIdx] == pxMap ) )
+            {
+                pxMap->pucData = ( UCHAR * )pvData;
+                pxMap->ulLength = ulLength;
+                pxMap->usFileNumber = usFileNumber;
+                pxMap->ucFlags = ucFlags;
+                pxMap->pxSync = pxSync;
+                pxMap->ulDirtyStart = 0;
+                pxMap->ulDirtyEnd = 0;
+                pxMBFileMaps[usIdx] = pxMap;
+                eStatus = MB_ENOERR;
+                break;
+            }
+        }
+    }
+    return eStatus;
+}
+
+void
+vMBFileMapSync( void )
+{
+    USHORT          usIdx;
+    ULONG           ulStart;
+    ULONG           ulEnd;
+    xMBFileMap     *pxMap;
+
+    for( usIdx = 0; usIdx < MB_FUNC_FILE_MAP_MAX; usIdx++ )
+    {
+        pxMap = pxMBFileMaps[usIdx];
+        if( ( pxMap != NULL ) && ( pxMap->pxSync != NULL ) )
+        {
+            /* Take the dirty range and reset it. Writes done after this
+             * point are reported by the next call. */
+            ENTER_CRITICAL_SECTION(  );
+            ulStart = pxMap->ulDirtyStart;
+            ulEnd = pxMap->ulDirtyEnd;
+            pxMap->ulDirtyStart = 0;
+            pxMap->ulDirtyEnd = 0;
+            EXIT_CRITICAL_SECTION(  );
+
+            if( ulEnd > ulStart )
+            {
+                pxMap->pxSync( pxMap, ulStart, ulEnd - ulStart );
+            }
+        }
+    }
+}
+
+eMBErrorCode
+eMBFileMapCB( xMBFileRequest * pxRequests, USHORT usNRequests, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    UCHAR           ucRequired = ( eMode == MB_REG_WRITE ) ? MB_FILE_MAP_WRITE : MB_FILE_MAP_READ;
+    xMBFileMap     *pxMap;
+    ULONG           ulOffset;
+    ULONG           ulBytes;
+    USHORT          usIdx;
+    USHORT         *pusWords;
+    UCHAR          *pucBuffer;
+
+    /* Check all sub-requests first so that a write is either done
+     * completely or not at all. */
+    for( usIdx = 0; usIdx < usNRequests; usIdx++ )
+    {
+        pxMap = prvpxMBFileMapFind( &pxRequests[usIdx], &ulOffset );
+        if( ( pxMap == NULL ) || ( ( pxMap->ucFlags & ucRequired ) == 0 ) )
+        {
+            eStatus = MB_ENOREG;
+            break;
+        }
+    }
+
+    for( usIdx = 0; ( eStatus == MB_ENOERR ) && ( usIdx < usNRequests ); usIdx++ )
+    {
+        pxMap = prvpxMBFileMapFind( &pxRequests[usIdx], &ulOffset );
+        ulBytes = 2UL * pxRequests[usIdx].usRecordLength;
+        pucBuffer = pxRequests[usIdx].pucFileBuffer;
+
+        if( pxMap->ucFlags & MB_FILE_MAP_BIG_ENDIAN )
+        {
+            /* The region already uses the byte order of the PDU. */
+            if( eMode == MB_REG_READ )
+            {
+                memcpy( pucBuffer, &pxMap->pucData[ulOffset], ( size_t )ulBytes );
+            }
+            else
+            {
+                memcpy( &pxMap->pucData[ulOffset], pucBuffer, ( size_t )ulBytes );
+            }
+        }
+        else
+        {
+            pusWords = ( USHORT * )&pxMap->pucData[ulOffset];
+            if( eMode == MB_REG_READ )
+            {
+                vMBUtilCopyRegsToPDU( pucBuffer, pusWords, pxRequests[usIdx].usRecordLength );
+            }
+            else
+            {
+                vMBUtilCopyRegsFromPDU( pusWords, pucBuffer, pxRequests[usIdx].usRecordLength );
+            }
+        }
+
+        if( eMode == MB_REG_WRITE )
+        {
+            ENTER_CRITICAL_SECTION(  );
+            if( pxMap->ulDirtyEnd == pxMap->ulDirtyStart )
+            {
+                pxMap->ulDirtyStart = ulOffset;
+                pxMap->ulDirtyEnd = ulOffset + ulBytes;
+            }
+            else
+            {
+                if( ulOffset < pxMap->ulDirtyStart )
+                {
+                    pxMap->ulDirtyStart = ulOffset;
+                }
+                if( ( ulOffset + ulBytes ) > pxMap->ulDirtyEnd )
+                {
+                    pxMap->ulDirtyEnd = ulOffset + ulBytes;
+                }
+            }
+            EXIT_CRITICAL_SECTION(  );
+        }
+    }
+    return eStatus;
+}
+
+static xMBFileMap *
+prvpxMBFileMapFind( xMBFileRequest * pxRequest, ULONG * pulOffset )
+{
+    xMBFileMap     *pxMap;
+    xMBFileMap     *pxFound = NULL;
+    ULONG           ulOffset;
+    USHORT          usIdx;
+
+    for( usIdx = 0; usIdx < MB_FUNC_FILE_MAP_MAX; usIdx++ )
+    {
+        pxMap = pxMBFileMaps[usIdx];
+        if( ( pxMap != NULL ) && ( pxRequest->usFileNumber >= pxMap->usFileNumber ) )
+        {
+            ulOffset = ( ULONG )( pxRequest->usFileNumber - pxMap->usFileNumber ) * MB_FILE_MAP_RECORDS;
+            ulOffset = ( ulOffset + pxRequest->usRecordNumber ) * 2UL;
+            if( ( ulOffset + 2UL * pxRequest->usRecordLength ) <= pxMap->ulLength )
+            {
+                *pulOffset = ulOffset;
+                pxFound = pxMap;
+                break;
+            }
+        }
+    }
+    return pxFound;
+}
+
+#endif
@@ -39,6 +39,8 @@
 #include "mbframe.h"
 #include "mbproto.h"
 #include "mbconfig.h"
+#include "mbregmap.h"
+#include "mbhooks.h"
 
 /* ----------------------- Defines ------------------------------------------*/
 #define MB_PDU_FUNC_READ_ADDR_OFF           ( MB_PDU_DATA_OFF )
@@ -112,8 +114,8 @@ eMBFuncReadCoils( UCHAR * pucFrame, USHORT * usLen )
             *usLen += 1;
 
             eRegStatus =
-                eMBRegCoilsCB( pucFrameCur, usRegAddress, usCoilCount,
-                               MB_REG_READ );
+                MB_REG_COILS_CB( pucFrameCur, usRegAddress, usCoilCount,
+                                 MB_REG_READ );
 
             /* If an error occured convert it into a Modbus exception. */
             if( eRegStatus != MB_ENOERR )
@@ -172,13 +174,17 @@ eMBFuncWriteCoil( UCHAR * pucFrame, USHORT * usLen )
                 ucBuf[0] = 0;
             }
             eRegStatus =
-                eMBRegCoilsCB( &ucBuf[0], usRegAddress, 1, MB_REG_WRITE );
+                MB_REG_COILS_CB( &ucBuf[0], usRegAddress, 1, MB_REG_WRITE );
 
             /* If an error occured convert it into a Modbus exception. */
             if( eRegStatus != MB_ENOERR )
             {
                 eStatus = prveMBError2Exception( eRegStatus );
             }
+            else
+            {
+                MB_HOOK_WRITE( MB_REG_MAP_COILS, usRegAddress, 1 );
+            }
         }
         else
         {
@@ -234,8 +240,8 @@ eMBFuncWriteMultipleCoils( UCHAR * pucFrame, USHORT * usLen )
             ( ucByteCountVerify == ucByteCount ) )
         {
             eRegStatus =
-                eMBRegCoilsCB( &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
-                               usRegAddress, usCoilCnt, MB_REG_WRITE );
+                MB_REG_COILS_CB( &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
+                                 usRegAddress, usCoilCnt, MB_REG_WRITE );
 
             /* If an error occured convert it into a Modbus exception. */
             if( eRegStatus != MB_ENOERR )
@@ -244,6 +250,8 @@ eMBFuncWriteMultipleCoils( UCHAR * pucFrame, USHORT * usLen )
             }
             else
             {
+                MB_HOOK_WRITE( MB_REG_MAP_COILS, usRegAddress, usCoilCnt );
+
                 /* The response contains the function code, the starting address
                  * and the quantity of registers. We reuse the old values in the 
                  * buffer because they are still valid. */
@@ -26,3 +26,360 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbconfig.h"
+#include "mbdiag.h"
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_FUNC_DIAG_SUBFUNC_OFF            ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_DIAG_DATA_OFF               ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_DIAG_SIZE_MIN               ( 2 )
+#define MB_PDU_FUNC_DIAG_SIZE                   ( 4 )
+
+#define MB_DIAG_RETURN_QUERY_DATA               ( 0x0000 )
+#define MB_DIAG_RESTART_COMM_OPTION             ( 0x0001 )
+#define MB_DIAG_CLEAR_COUNTERS                  ( 0x000A )
+#define MB_DIAG_BUS_MESSAGE_COUNT               ( 0x000B )
+#define MB_DIAG_BUS_CHAR_OVERRUN_COUNT          ( 0x0012 )
+#define MB_DIAG_CLEAR_OVERRUN_COUNTER           ( 0x0014 )
+
+#define MB_DIAG_RESTART_CLEAR_LOG               ( 0xFF00 )
+
+#define MB_PDU_FUNC_EVENT_STATUS_OFF            ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_EVENT_COUNT_OFF             ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_EVENT_LOG_BYTECNT_OFF       ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_EVENT_LOG_STATUS_OFF        ( MB_PDU_DATA_OFF + 1 )
+#define MB_PDU_FUNC_EVENT_LOG_EVENTCNT_OFF      ( MB_PDU_DATA_OFF + 3 )
+#define MB_PDU_FUNC_EVENT_LOG_MSGCNT_OFF        ( MB_PDU_DATA_OFF + 5 )
+#define MB_PDU_FUNC_EVENT_LOG_EVENTS_OFF        ( MB_PDU_DATA_OFF + 7 )
+#define MB_PDU_FUNC_EVENT_LOG_HEADER_SIZE       ( 6 )
+
+#define MB_DIAG_EVENT_RECEIVE                   ( 0x80 )
+#define MB_DIAG_EVENT_SEND                      ( 0x40 )
+#define MB_DIAG_EVENT_TX_READ_EXCEPTION         ( 0x01 )
+#define MB_DIAG_EVENT_TX_ABORT_EXCEPTION        ( 0x02 )
+#define MB_DIAG_EVENT_TX_BUSY_EXCEPTION         ( 0x04 )
+#define MB_DIAG_EVENT_TX_NAK_EXCEPTION          ( 0x08 )
+#define MB_DIAG_EVENT_RESTART                   ( 0x00 )
+
+/* ----------------------- Static variables ---------------------------------*/
+#if ( MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0 ) || ( MB_FUNC_DIAG_COM_EVENT_ENABLED > 0 )
+volatile USHORT usMBDiagCounters[MB_DIAG_CNT_MAX];
+#endif
+
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+/* The event log is a ring buffer where ucMBEventLogPos is the position
+ * of the next event. It is only written by the task calling eMBPoll( ) and
+ * therefore does not require any locking. */
+static UCHAR    ucMBEventLog[MB_FUNC_DIAG_COM_EVENT_LOG_SIZE];
+static USHORT   usMBEventLogPos;
+static USHORT   usMBEventLogCount;
+static USHORT   usMBEventCount;
+static USHORT   usMBEventLastOverruns;
+#endif
+
+/* ----------------------- Static functions ---------------------------------*/
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+static void     prvvMBDiagEventAdd( UCHAR ucEvent );
+#endif
+
+#if MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0
+static void     prvvMBDiagClearCounters( void );
+#endif
+
+/* ----------------------- Start implementation -----------------------------*/
+#if ( MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0 ) || ( MB_FUNC_DIAG_COM_EVENT_ENABLED > 0 )
+void
+vMBDiagException( eMBException eException )
+{
+    usMBDiagCounters[MB_DIAG_CNT_BUS_EXCEPTION]++;
+    if( eException == MB_EX_SLAVE_BUSY )
+    {
+        usMBDiagCounters[MB_DIAG_CNT_SLAVE_BUSY]++;
+    }
+    else if( eException == MB_EX_NEGATIVE_ACKNOWLEDGE )
+    {
+        usMBDiagCounters[MB_DIAG_CNT_SLAVE_NAK]++;
+    }
+}
+#endif
+
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+void
+vMBDiagEventReceive( UCHAR ucEvent )
+{
+    USHORT          usOverruns = usMBDiagCounters[MB_DIAG_CNT_BUS_CHAR_OVERRUN];
+
+    /* Overruns are detected in the receiver interrupt. Instead of writing to
+     * the log from there we report them with the next receive event. */
+    if( usOverruns != usMBEventLastOverruns )
+    {
+        usMBEventLastOverruns = usOverruns;
+        ucEvent |= MB_DIAG_EVENT_RX_OVERRUN;
+    }
+    prvvMBDiagEventAdd( ( UCHAR )( MB_DIAG_EVENT_RECEIVE | ucEvent ) );
+}
+
+void
+vMBDiagEventSend( UCHAR ucFunctionCode, eMBException eException )
+{
+    UCHAR           ucEvent = MB_DIAG_EVENT_SEND;
+
+    switch ( eException )
+    {
+    case MB_EX_NONE:
+        /* Only successfully completed requests are counted. Polling the
+         * counter itself does not change it. */
+        if( ucFunctionCode != MB_FUNC_DIAG_GET_COM_EVENT_CNT )
+        {
+            usMBEventCount++;
+        }
+        break;
+
+    case MB_EX_ILLEGAL_FUNCTION:
+    case MB_EX_ILLEGAL_DATA_ADDRESS:
+    case MB_EX_ILLEGAL_DATA_VALUE:
+        ucEvent |= MB_DIAG_EVENT_TX_READ_EXCEPTION;
+        break;
+
+    case MB_EX_SLAVE_DEVICE_FAILURE:
+        ucEvent |= MB_DIAG_EVENT_TX_ABORT_EXCEPTION;
+        break;
+
+    case MB_EX_ACKNOWLEDGE:
+    case MB_EX_SLAVE_BUSY:
+        ucEvent |= MB_DIAG_EVENT_TX_BUSY_EXCEPTION;
+        break;
+
+    case MB_EX_NEGATIVE_ACKNOWLEDGE:
+        ucEvent |= MB_DIAG_EVENT_TX_NAK_EXCEPTION;
+        break;
+
+    default:
+        break;
+    }
+    prvvMBDiagEventAdd( ucEvent );
+}
+
+void
+vMBDiagEventRestart( BOOL xClearLog )
+{
+    if( xClearLog )
+    {
+        usMBEventLogPos = 0;
+        usMBEventLogCount = 0;
+    }
+    usMBEventCount = 0;
+    prvvMBDiagEventAdd( MB_DIAG_EVENT_RESTART );
+}
+
+static void
+prvvMBDiagEventAdd( UCHAR ucEvent )
+{
+    ucMBEventLog[usMBEventLogPos++] = ucEvent;
+    if( usMBEventLogPos == MB_FUNC_DIAG_COM_EVENT_LOG_SIZE )
+    {
+        usMBEventLogPos = 0;
+    }
+    if( usMBEventLogCount < MB_FUNC_DIAG_COM_EVENT_LOG_SIZE )
+    {
+        usMBEventLogCount++;
+    }
+}
+
+eMBException
+eMBFuncGetCommEventCounter( UCHAR * pucFrame, USHORT * usLen )
+{
+    eMBException    eStatus = MB_EX_NONE;
+
+    if( *usLen == MB_PDU_SIZE_MIN )
+    {
+        /* Requests are always completed before the next one is processed.
+         * Therefore the status word is never busy. */
+        pucFrame[MB_PDU_FUNC_EVENT_STATUS_OFF] = 0x00;
+        pucFrame[MB_PDU_FUNC_EVENT_STATUS_OFF + 1] = 0x00;
+        pucFrame[MB_PDU_FUNC_EVENT_COUNT_OFF] = ( UCHAR )( usMBEventCount >> 8 );
+        pucFrame[MB_PDU_FUNC_EVENT_COUNT_OFF + 1] = ( UCHAR )( usMBEventCount & 0xFF );
+        *usLen = MB_PDU_FUNC_EVENT_COUNT_OFF + 2;
+    }
+    else
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+eMBException
+eMBFuncGetCommEventLog( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usMessages;
+    USHORT          usPos;
+    USHORT          usIdx;
+    UCHAR          *pucFrameCur;
+    eMBException    eStatus = MB_EX_NONE;
+
+    if( *usLen == MB_PDU_SIZE_MIN )
+    {
+        usMessages = usMBDiagCounters[MB_DIAG_CNT_BUS_MESSAGE];
+
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_BYTECNT_OFF] =
+            ( UCHAR )( MB_PDU_FUNC_EVENT_LOG_HEADER_SIZE + usMBEventLogCount );
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_STATUS_OFF] = 0x00;
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_STATUS_OFF + 1] = 0x00;
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_EVENTCNT_OFF] = ( UCHAR )( usMBEventCount >> 8 );
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_EVENTCNT_OFF + 1] = ( UCHAR )( usMBEventCount & 0xFF );
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_MSGCNT_OFF] = ( UCHAR )( usMessages >> 8 );
+        pucFrame[MB_PDU_FUNC_EVENT_LOG_MSGCNT_OFF + 1] = ( UCHAR )( usMessages & 0xFF );
+
+        /* The most recent event is sent first. */
+        pucFrameCur = &pucFrame[MB_PDU_FUNC_EVENT_LOG_EVENTS_OFF];
+        usPos = usMBEventLogPos;
+        for( usIdx = 0; usIdx < usMBEventLogCount; usIdx++ )
+        {
+            usPos = ( usPos == 0 ) ? ( MB_FUNC_DIAG_COM_EVENT_LOG_SIZE - 1 ) : ( usPos - 1 );
+            *pucFrameCur++ = ucMBEventLog[usPos];
+        }
+        *usLen = ( USHORT )( MB_PDU_FUNC_EVENT_LOG_EVENTS_OFF + usMBEventLogCount );
+    }
+    else
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+#endif
+
+#if MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0
+eMBException
+eMBFuncDiagnostic( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usSubFunction;
+    USHORT          usData;
+    eMBException    eStatus = MB_EX_NONE;
+
+    if( *usLen >= ( MB_PDU_FUNC_DIAG_SIZE_MIN + MB_PDU_SIZE_MIN ) )
+    {
+        usSubFunction = ( USHORT )( pucFrame[MB_PDU_FUNC_DIAG_SUBFUNC_OFF] << 8 );
+        usSubFunction |= ( USHORT )( pucFrame[MB_PDU_FUNC_DIAG_SUBFUNC_OFF + 1] );
+
+        if( usSubFunction == MB_DIAG_RETURN_QUERY_DATA )
+        {
+            /* The response is an echo of the request. We simply keep the
+             * frame and its length as they are. */
+        }
+        else if( *usLen != ( MB_PDU_FUNC_DIAG_SIZE + MB_PDU_SIZE_MIN ) )
+        {
+            /* All other sub-functions have exactly one data word. */
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+        else
+        {
+            usData = ( USHORT )( pucFrame[MB_PDU_FUNC_DIAG_DATA_OFF] << 8 );
+            usData |= ( USHORT )( pucFrame[MB_PDU_FUNC_DIAG_DATA_OFF + 1] );
+
+            switch ( usSubFunction )
+            {
+            case MB_DIAG_RESTART_COMM_OPTION:
+                /* We do not reinitialize the port because this would
+                 * destroy the response. Restarting the communication
+                 * is therefore reduced to clearing the counters. */
+                if( ( usData == 0x0000 ) || ( usData == MB_DIAG_RESTART_CLEAR_LOG ) )
+                {
+                    prvvMBDiagClearCounters(  );
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+                    vMBDiagEventRestart( usData == MB_DIAG_RESTART_CLEAR_LOG );
+#endif
+                }
+                else
+                {
+                    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+                }
+                break;
+
+            case MB_DIAG_CLEAR_COUNTERS:
+                if( usData == 0x0000 )
+                {
+                    prvvMBDiagClearCounters(  );
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+                    usMBEventCount = 0;
+#endif
+                }
+                else
+                {
+                    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+                }
+                break;
+
+            case MB_DIAG_CLEAR_OVERRUN_COUNTER:
+                if( usData == 0x0000 )
+                {
+                    usMBDiagCounters[MB_DIAG_CNT_BUS_CHAR_OVERRUN] = 0;
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+                    usMBEventLastOverruns = 0;
+#endif
+                }
+                else
+                {
+                    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+                }
+                break;
+
+            default:
+                if( ( usSubFunction < MB_DIAG_BUS_MESSAGE_COUNT ) ||
+                    ( usSubFunction > MB_DIAG_BUS_CHAR_OVERRUN_COUNT ) )
+                {
+                    eStatus = MB_EX_ILLEGAL_FUNCTION;
+                }
+                else if( usData != 0x0000 )
+                {
+                    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+                }
+                else
+                {
+                    /* The counters are in the same order as the sub-function
+                     * codes. The response replaces the data field with
+                     * the counter value. */
+                    usData = usMBDiagCounters[usSubFunction - MB_DIAG_BUS_MESSAGE_COUNT];
+                    pucFrame[MB_PDU_FUNC_DIAG_DATA_OFF] = ( UCHAR )( usData >> 8 );
+                    pucFrame[MB_PDU_FUNC_DIAG_DATA_OFF + 1] = ( UCHAR )( usData & 0xFF );
+                }
+                break;
+            }
+        }
+    }
+    else
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+static void
+prvvMBDiagClearCounters( void )
+{
+    USHORT          usIdx;
+
+    for( usIdx = 0; usIdx < MB_DIAG_CNT_MAX; usIdx++ )
+    {
+        usMBDiagCounters[usIdx] = 0;
+    }
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+    usMBEventLastOverruns = 0;
+#endif
+}
+
+#endif
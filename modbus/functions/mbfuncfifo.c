@@ -0,0 +1,175 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbconfig.h"
+#include "mbatomic.h"
+#include "mbfifo.h"
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_FUNC_FIFO_ADDR_OFF               ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_FIFO_SIZE                   ( 2 )
+#define MB_PDU_FUNC_FIFO_BYTECNT_OFF            ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_FIFO_COUNT_OFF              ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_FIFO_VALUES_OFF             ( MB_PDU_DATA_OFF + 4 )
+#define MB_PDU_FUNC_FIFO_COUNT_MAX              ( 31 )
+
+#if MB_FUNC_READ_FIFO_ENABLED > 0
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBFifo *pxMBFifos[MB_FUNC_READ_FIFO_MAX];
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBFifoRegister( xMBFifo * pxFifo, USHORT usAddress, USHORT * pusBuffer, USHORT usSize )
+{
+    eMBErrorCode    eStatus = MB_ENORES;
+    USHORT          usIdx;
+
+    if( ( usSize == 0 ) || ( ( usSize & ( usSize - 1 ) ) != 0 ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        for( usIdx = 0; usIdx < MB_FUNC_READ_FIFO_MAX; usIdx++ )
+        {
+            if( ( pxMBFifos[usIdx] == NULL ) || ( pxMBFifos[usIdx] == pxFifo ) )
+            {
+                pxFifo->usAddress = usAddress;
+                pxFifo->pusBuffer = pusBuffer;
+                pxFifo->usMask = ( USHORT )( usSize - 1 );
+                pxFifo->usHead = 0;
+                pxFifo->usTail = 0;
+                pxMBFifos[usIdx] = pxFifo;
+                eStatus = MB_ENOERR;
+                break;
+            }
+        }
+    }
+    return eStatus;
+}
+
+BOOL
+xMBFifoPush( xMBFifo * pxFifo, USHORT usValue )
+{
+    USHORT          usHead = pxFifo->usHead;
+    USHORT          usTail;
+    BOOL            xResult = FALSE;
+
+    /* The indices are free running. The number of queued values is
+     * their difference. */
+    MB_ATOMIC_LOAD_ACQUIRE( &pxFifo->usTail, usTail );
+    if( ( USHORT )( usHead - usTail ) <= pxFifo->usMask )
+    {
+        pxFifo->pusBuffer[usHead & pxFifo->usMask] = usValue;
+        MB_ATOMIC_STORE_RELEASE( &pxFifo->usHead, ( USHORT )( usHead + 1 ) );
+        xResult = TRUE;
+    }
+    return xResult;
+}
+
+eMBException
+eMBFuncReadFifoQueue( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usFifoAddress;
+    USHORT          usHead;
+    USHORT          usTail;
+    USHORT          usCount;
+    USHORT          usValue;
+    USHORT          usIdx;
+    UCHAR          *pucFrameCur;
+    xMBFifo        *pxFifo = NULL;
+    eMBException    eStatus = MB_EX_NONE;
+
+    if( *usLen == ( MB_PDU_FUNC_FIFO_SIZE + MB_PDU_SIZE_MIN ) )
+    {
+        usFifoAddress = ( USHORT )( pucFrame[MB_PDU_FUNC_FIFO_ADDR_OFF] << 8 );
+        usFifoAddress |= ( USHORT )( pucFrame[MB_PDU_FUNC_FIFO_ADDR_OFF + 1] );
+        usFifoAddress++;
+
+        for( usIdx = 0; usIdx < MB_FUNC_READ_FIFO_MAX; usIdx++ )
+        {
+            if( ( pxMBFifos[usIdx] != NULL ) && ( pxMBFifos[usIdx]->usAddress == usFifoAddress ) )
+            {
+                pxFifo = pxMBFifos[usIdx];
+                break;
+            }
+        }
+
+        if( pxFifo == NULL )
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_ADDRESS;
+        }
+        else
+        {
+            usTail = pxFifo->usTail;
+            MB_ATOMIC_LOAD_ACQUIRE( &pxFifo->usHead, usHead );
+            usCount = ( USHORT )( usHead - usTail );
+            if( usCount > MB_PDU_FUNC_FIFO_COUNT_MAX )
+            {
+                usCount = MB_PDU_FUNC_FIFO_COUNT_MAX;
+            }
+
+            pucFrame[MB_PDU_FUNC_FIFO_BYTECNT_OFF] = 0;
+            pucFrame[MB_PDU_FUNC_FIFO_BYTECNT_OFF + 1] = ( UCHAR )( 2 + 2 * usCount );
+            pucFrame[MB_PDU_FUNC_FIFO_COUNT_OFF] = 0;
+            pucFrame[MB_PDU_FUNC_FIFO_COUNT_OFF + 1] = ( UCHAR )usCount;
+            pucFrameCur = &pucFrame[MB_PDU_FUNC_FIFO_VALUES_OFF];
+            for( usIdx = 0; usIdx < usCount; usIdx++ )
+            {
+                usValue = pxFifo->pusBuffer[( usTail + usIdx ) & pxFifo->usMask];
+                *pucFrameCur++ = ( UCHAR )( usValue >> 8 );
+                *pucFrameCur++ = ( UCHAR )( usValue & 0xFF );
+            }
+
+            /* Release the slots to the producer. */
+            MB_ATOMIC_STORE_RELEASE( &pxFifo->usTail, ( USHORT )( usTail + usCount ) );
+            *usLen = ( USHORT )( MB_PDU_FUNC_FIFO_VALUES_OFF + 2 * usCount );
+        }
+    }
+    else
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+#endif
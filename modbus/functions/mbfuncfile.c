@@ -39,29 +39,43 @@
 #include "mbframe.h"
 #include "mbproto.h"
 #include "mbconfig.h"
+#include "mbfilemap.h"
 
 /* ----------------------- Defines ------------------------------------------*/
-#define MB_PDU_FUNC_FILE_FRAME_LEN_OFF  ( MB_PDU_DATA_OFF )
-#define MB_PDU_FUNC_FILE_REF_TYPE_OFF   ( MB_PDU_DATA_OFF + 1 )
-#define MB_PDU_FUNC_FILE_NUM_OFF        ( MB_PDU_DATA_OFF + 2 )
-#define MB_PDU_FUNC_FILE_REC_NUM_OFF    ( MB_PDU_DATA_OFF + 4 )
-#define MB_PDU_FUNC_FILE_REC_LEN_OFF    ( MB_PDU_DATA_OFF + 6 )
-#define MB_PDU_FUNC_FILE_DATA_OFF       ( MB_PDU_DATA_OFF + 8 )
+#define MB_PDU_FUNC_FILE_BYTECNT_OFF            ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_FILE_GROUPS_OFF             ( MB_PDU_DATA_OFF + 1 )
+#define MB_PDU_FUNC_FILE_READ_BYTECNT_MIN       ( 0x07 )
+#define MB_PDU_FUNC_FILE_READ_BYTECNT_MAX       ( 0xF5 )
+#define MB_PDU_FUNC_FILE_WRITE_BYTECNT_MIN      ( 0x09 )
+#define MB_PDU_FUNC_FILE_WRITE_BYTECNT_MAX      ( 0xFB )
+#define MB_PDU_FUNC_FILE_RESP_BYTECNT_MAX       ( 0xF5 )
 
-#define MB_PDU_FUNC_FILE_OVERHEAD       ( 7 )
-#define MB_PDU_FUNC_FILE_MIN_SIZE       ( MB_PDU_FUNC_FILE_OVERHEAD + 2 )
+/* Offsets within a sub-request. */
+#define MB_FILE_GROUP_REF_TYPE_OFF              ( 0 )
+#define MB_FILE_GROUP_NUM_OFF                   ( 1 )
+#define MB_FILE_GROUP_REC_NUM_OFF               ( 3 )
+#define MB_FILE_GROUP_REC_LEN_OFF               ( 5 )
+#define MB_FILE_GROUP_DATA_OFF                  ( 7 )
+#define MB_FILE_GROUP_SIZE                      ( 7 )
 
-#define MB_PDU_FUNC_FILE_REF_TYPE       ( 6 )
+/* Offsets within a sub-response of a read. */
+#define MB_FILE_RESP_GROUP_LEN_OFF              ( 0 )
+#define MB_FILE_RESP_GROUP_REF_TYPE_OFF         ( 1 )
+#define MB_FILE_RESP_GROUP_DATA_OFF             ( 2 )
 
-#define MB_PDU_FUNC_FILE_MAX_LEN        ( MB_PDU_SIZE_MAX - MB_PDU_FUNC_FILE_OVERHEAD )
-
-#define MB_PDU_FUNC_FILE_RESP_LEN_OFF   ( MB_PDU_DATA_OFF + 1 )
-#define MB_PDU_FUNC_FILE_RESP_TYPE_OFF  ( MB_PDU_DATA_OFF + 2 )
-#define MB_PDU_FUNC_FILE_RESP_DATA_OFF  ( MB_PDU_DATA_OFF + 3 )
+#define MB_FILE_REF_TYPE                        ( 6 )
+#define MB_FILE_REC_NUM_MAX                     ( 0x270F )
+#define MB_FILE_REC_LEN_MAX                     ( ( MB_PDU_SIZE_MAX - MB_PDU_FUNC_FILE_GROUPS_OFF - MB_FILE_RESP_GROUP_DATA_OFF ) / 2 )
 
 /* ----------------------- Static functions ---------------------------------*/
 eMBException    prveMBError2Exception( eMBErrorCode eErrorCode );
 
+#if ( MB_FUNC_WRITE_FILE_ENABLED > 0 ) || ( MB_FUNC_READ_FILE_ENABLED > 0 )
+static eMBException prveMBFileParseGroup( UCHAR * pucGroup, xMBFileRequest * pxRequest );
+static eMBException prveMBFileCallback( xMBFileRequest * pxRequests, USHORT usNRequests,
+                                        eMBRegisterMode eMode );
+#endif
+
 /* ----------------------- Start implementation -----------------------------*/
 
 #if MB_FUNC_WRITE_FILE_ENABLED > 0
@@ -69,50 +83,54 @@ eMBException    prveMBError2Exception( eMBErrorCode eErrorCode );
 eMBException
 eMBFuncWriteFileRecord( UCHAR * pucFrame, USHORT * usLen )
 {
-    UCHAR           ucFrameLen;
-    UCHAR           ucRefType;
-    USHORT          usFileNum;
-    USHORT          usFileRec;
-    USHORT          usFileRecLen;
-    USHORT          usFileByteLen;
+    xMBFileRequest  xRequests[MB_FUNC_FILE_REQUESTS_MAX];
+    USHORT          usNRequests = 0;
+    USHORT          usOffset;
+    UCHAR           ucByteCount;
     eMBException    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
-    eMBErrorCode    eRegStatus;
 
-    if ( *usLen >= MB_PDU_FUNC_FILE_MIN_SIZE )
+    if( *usLen > MB_PDU_FUNC_FILE_GROUPS_OFF )
     {
-        ucFrameLen = pucFrame[MB_PDU_FUNC_FILE_FRAME_LEN_OFF];
-        ucRefType = pucFrame[MB_PDU_FUNC_FILE_REF_TYPE_OFF];
-        usFileNum = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_NUM_OFF] << 8 );
-        usFileNum |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_NUM_OFF + 1] );
-        usFileRec = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_NUM_OFF] << 8 );
-        usFileRec |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_NUM_OFF + 1] );
-        usFileRecLen = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_LEN_OFF] << 8 );
-        usFileRecLen |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_LEN_OFF + 1] );
-
-        usFileByteLen = usFileRecLen * 2;
-
-        /* TODO - allow multiple writes per request (as per spec) */
-        if ( (usFileByteLen <= MB_PDU_FUNC_FILE_MAX_LEN)
-            && ( ucFrameLen == (MB_PDU_FUNC_FILE_OVERHEAD + usFileByteLen) ) )
+        ucByteCount = pucFrame[MB_PDU_FUNC_FILE_BYTECNT_OFF];
+        if( ( *usLen == ( MB_PDU_FUNC_FILE_GROUPS_OFF + ucByteCount ) ) &&
+            ( ucByteCount >= MB_PDU_FUNC_FILE_WRITE_BYTECNT_MIN ) &&
+            ( ucByteCount <= MB_PDU_FUNC_FILE_WRITE_BYTECNT_MAX ) )
         {
-            /* Make callback to write the records */
-            eRegStatus = eMBRegFileCB( &pucFrame[MB_PDU_FUNC_FILE_DATA_OFF], usFileNum,
-                                       usFileRec, usFileRecLen, MB_REG_WRITE );
+            eStatus = MB_EX_NONE;
+        }
+    }
 
-            if ( eRegStatus == MB_ENOERR )
-            {
-                eStatus = MB_EX_NONE;
-            }
-            else
+    /* Each sub-request is followed by its data. The data is passed to the
+     * application directly from the frame. */
+    usOffset = MB_PDU_FUNC_FILE_GROUPS_OFF;
+    while( ( eStatus == MB_EX_NONE ) && ( usOffset < *usLen ) )
+    {
+        if( ( usNRequests == MB_FUNC_FILE_REQUESTS_MAX ) ||
+            ( ( usOffset + MB_FILE_GROUP_SIZE ) > *usLen ) )
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+        else
+        {
+            eStatus = prveMBFileParseGroup( &pucFrame[usOffset], &xRequests[usNRequests] );
+        }
+        if( eStatus == MB_EX_NONE )
+        {
+            xRequests[usNRequests].pucFileBuffer = &pucFrame[usOffset + MB_FILE_GROUP_DATA_OFF];
+            usOffset += MB_FILE_GROUP_DATA_OFF + 2 * xRequests[usNRequests].usRecordLength;
+            if( usOffset > *usLen )
             {
-                /* If an error occured convert it into a Modbus exception. */
-                eStatus = prveMBError2Exception( eRegStatus );
+                eStatus = MB_EX_ILLEGAL_DATA_VALUE;
             }
+            usNRequests++;
         }
-        /* else Record length too long - default status illegal data value. */
     }
-    /* else Frame length too short - default status illegal data value. */
-    
+
+    /* The response is an echo of the request. */
+    if( eStatus == MB_EX_NONE )
+    {
+        eStatus = prveMBFileCallback( xRequests, usNRequests, MB_REG_WRITE );
+    }
     return eStatus;
 }
 #endif
@@ -122,56 +140,123 @@ eMBFuncWriteFileRecord( UCHAR * pucFrame, USHORT * usLen )
 eMBException
 eMBFuncReadFileRecord( UCHAR * pucFrame, USHORT * usLen )
 {
-    UCHAR           ucFrameLen;
-    UCHAR           ucRefType;
-    USHORT          usFileNum;
-    USHORT          usFileRec;
-    USHORT          usFileRecLen;
-    USHORT          usFileByteLen;
+    xMBFileRequest  xRequests[MB_FUNC_FILE_REQUESTS_MAX];
+    USHORT          usNRequests = 0;
+    USHORT          usOffset;
+    USHORT          usRespOffset;
+    USHORT          usIdx;
+    UCHAR          *pucGroup;
+    UCHAR           ucByteCount;
     eMBException    eStatus = MB_EX_ILLEGAL_DATA_VALUE;
-    eMBErrorCode    eRegStatus;
 
-    /* TODO - allow for multiple reads per requests (per standard) */
-    /* For now only a single read is permitted per request */
-    if ( *usLen == MB_PDU_FUNC_FILE_DATA_OFF )
+    if( *usLen > MB_PDU_FUNC_FILE_GROUPS_OFF )
     {
-        ucFrameLen = pucFrame[MB_PDU_FUNC_FILE_FRAME_LEN_OFF];
-        ucRefType = pucFrame[MB_PDU_FUNC_FILE_REF_TYPE_OFF];
-        usFileNum = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_NUM_OFF] << 8 );
-        usFileNum |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_NUM_OFF + 1] );
-        usFileRec = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_NUM_OFF] << 8 );
-        usFileRec |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_NUM_OFF + 1] );
-        usFileRecLen = ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_LEN_OFF] << 8 );
-        usFileRecLen |= ( USHORT )( pucFrame[MB_PDU_FUNC_FILE_REC_LEN_OFF + 1] );
-
-        usFileByteLen = usFileRecLen * 2;
-
-        if ( (usFileByteLen <= MB_PDU_FUNC_FILE_MAX_LEN) && (MB_PDU_FUNC_FILE_OVERHEAD == ucFrameLen) )
+        ucByteCount = pucFrame[MB_PDU_FUNC_FILE_BYTECNT_OFF];
+        if( ( *usLen == ( MB_PDU_FUNC_FILE_GROUPS_OFF + ucByteCount ) ) &&
+            ( ucByteCount >= MB_PDU_FUNC_FILE_READ_BYTECNT_MIN ) &&
+            ( ucByteCount <= MB_PDU_FUNC_FILE_READ_BYTECNT_MAX ) &&
+            ( ( ucByteCount % MB_FILE_GROUP_SIZE ) == 0 ) &&
+            ( ( ucByteCount / MB_FILE_GROUP_SIZE ) <= MB_FUNC_FILE_REQUESTS_MAX ) )
         {
-            /* Make callback to read the records. */
-            eRegStatus = eMBRegFileCB( &pucFrame[MB_PDU_FUNC_FILE_RESP_DATA_OFF], usFileNum,
-                                       usFileRec, usFileRecLen, MB_REG_READ );
-
-            if ( eRegStatus == MB_ENOERR )
-            {
-                pucFrame[MB_PDU_FUNC_FILE_FRAME_LEN_OFF] = 2 + usFileByteLen;
-                pucFrame[MB_PDU_FUNC_FILE_RESP_LEN_OFF] = 1 + usFileByteLen;
-                pucFrame[MB_PDU_FUNC_FILE_RESP_TYPE_OFF] = ucRefType;
-                *usLen = MB_PDU_FUNC_FILE_RESP_DATA_OFF + usFileByteLen;
+            eStatus = MB_EX_NONE;
+        }
+    }
 
-                eStatus = MB_EX_NONE;
-            }
-            else
+    /* The sub-responses are larger than the sub-requests and would
+     * overwrite them. Therefore all sub-requests are parsed first and the
+     * position of each sub-response is computed. */
+    usOffset = MB_PDU_FUNC_FILE_GROUPS_OFF;
+    usRespOffset = MB_PDU_FUNC_FILE_GROUPS_OFF;
+    while( ( eStatus == MB_EX_NONE ) && ( usOffset < *usLen ) )
+    {
+        eStatus = prveMBFileParseGroup( &pucFrame[usOffset], &xRequests[usNRequests] );
+        if( eStatus == MB_EX_NONE )
+        {
+            xRequests[usNRequests].pucFileBuffer =
+                &pucFrame[usRespOffset + MB_FILE_RESP_GROUP_DATA_OFF];
+            usRespOffset += MB_FILE_RESP_GROUP_DATA_OFF + 2 * xRequests[usNRequests].usRecordLength;
+            if( ( usRespOffset - MB_PDU_FUNC_FILE_GROUPS_OFF ) > MB_PDU_FUNC_FILE_RESP_BYTECNT_MAX )
             {
-                /* An error occured - convert it into a Modbus exception. */
-                eStatus = prveMBError2Exception( eRegStatus );
+                eStatus = MB_EX_ILLEGAL_DATA_VALUE;
             }
+            usOffset += MB_FILE_GROUP_SIZE;
+            usNRequests++;
         }
-        /* else Record length too long - default status illegal data value. */
     }
-    /* else Frame length too short - default status illegal data value. */
 
+    if( eStatus == MB_EX_NONE )
+    {
+        eStatus = prveMBFileCallback( xRequests, usNRequests, MB_REG_READ );
+    }
+
+    if( eStatus == MB_EX_NONE )
+    {
+        for( usIdx = 0; usIdx < usNRequests; usIdx++ )
+        {
+            pucGroup = xRequests[usIdx].pucFileBuffer - MB_FILE_RESP_GROUP_DATA_OFF;
+            pucGroup[MB_FILE_RESP_GROUP_LEN_OFF] = ( UCHAR )( 1 + 2 * xRequests[usIdx].usRecordLength );
+            pucGroup[MB_FILE_RESP_GROUP_REF_TYPE_OFF] = MB_FILE_REF_TYPE;
+        }
+        pucFrame[MB_PDU_FUNC_FILE_BYTECNT_OFF] = ( UCHAR )( usRespOffset - MB_PDU_FUNC_FILE_GROUPS_OFF );
+        *usLen = usRespOffset;
+    }
     return eStatus;
 }
 
 #endif
+
+#if ( MB_FUNC_WRITE_FILE_ENABLED > 0 ) || ( MB_FUNC_READ_FILE_ENABLED > 0 )
+
+static          eMBException
+prveMBFileParseGroup( UCHAR * pucGroup, xMBFileRequest * pxRequest )
+{
+    eMBException    eStatus = MB_EX_NONE;
+
+    pxRequest->usFileNumber = ( USHORT )( pucGroup[MB_FILE_GROUP_NUM_OFF] << 8 );
+    pxRequest->usFileNumber |= ( USHORT )( pucGroup[MB_FILE_GROUP_NUM_OFF + 1] );
+    pxRequest->usRecordNumber = ( USHORT )( pucGroup[MB_FILE_GROUP_REC_NUM_OFF] << 8 );
+    pxRequest->usRecordNumber |= ( USHORT )( pucGroup[MB_FILE_GROUP_REC_NUM_OFF + 1] );
+    pxRequest->usRecordLength = ( USHORT )( pucGroup[MB_FILE_GROUP_REC_LEN_OFF] << 8 );
+    pxRequest->usRecordLength |= ( USHORT )( pucGroup[MB_FILE_GROUP_REC_LEN_OFF + 1] );
+
+    if( ( pucGroup[MB_FILE_GROUP_REF_TYPE_OFF] != MB_FILE_REF_TYPE ) ||
+        ( pxRequest->usFileNumber == 0 ) ||
+        ( pxRequest->usRecordNumber > MB_FILE_REC_NUM_MAX ) )
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+    else if( ( pxRequest->usRecordLength == 0 ) ||
+             ( pxRequest->usRecordLength > MB_FILE_REC_LEN_MAX ) )
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+static          eMBException
+prveMBFileCallback( xMBFileRequest * pxRequests, USHORT usNRequests, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eRegStatus;
+
+#if MB_FUNC_FILE_MAP_ENABLED > 0
+    eRegStatus = eMBFileMapCB( pxRequests, usNRequests, eMode );
+#elif MB_FUNC_FILE_VEC_CB_ENABLED > 0
+    eRegStatus = eMBRegFileVecCB( pxRequests, usNRequests, eMode );
+#else
+    USHORT          usIdx;
+
+    eRegStatus = MB_ENOERR;
+    for( usIdx = 0; ( eRegStatus == MB_ENOERR ) && ( usIdx < usNRequests ); usIdx++ )
+    {
+        eRegStatus = eMBRegFileCB( pxRequests[usIdx].pucFileBuffer,
+                                   pxRequests[usIdx].usFileNumber,
+                                   pxRequests[usIdx].usRecordNumber,
+                                   pxRequests[usIdx].usRecordLength, eMode );
+    }
+#endif
+
+    /* If an error occured convert it into a Modbus exception. */
+    return ( eRegStatus == MB_ENOERR ) ? MB_EX_NONE : prveMBError2Exception( eRegStatus );
+}
+
+#endif
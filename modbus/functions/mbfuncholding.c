@@ -39,6 +39,8 @@
 #include "mbframe.h"
 #include "mbproto.h"
 #include "mbconfig.h"
+#include "mbregmap.h"
+#include "mbhooks.h"
 
 /* ----------------------- Defines ------------------------------------------*/
 #define MB_PDU_FUNC_READ_ADDR_OFF               ( MB_PDU_DATA_OFF + 0)
@@ -57,6 +59,11 @@
 #define MB_PDU_FUNC_WRITE_MUL_SIZE_MIN          ( 5 )
 #define MB_PDU_FUNC_WRITE_MUL_REGCNT_MAX        ( 0x0078 )
 
+#define MB_PDU_FUNC_MASK_WRITE_ADDR_OFF         ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_MASK_WRITE_AND_OFF          ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_MASK_WRITE_OR_OFF           ( MB_PDU_DATA_OFF + 4 )
+#define MB_PDU_FUNC_MASK_WRITE_SIZE             ( 6 )
+
 #define MB_PDU_FUNC_READWRITE_READ_ADDR_OFF     ( MB_PDU_DATA_OFF + 0 )
 #define MB_PDU_FUNC_READWRITE_READ_REGCNT_OFF   ( MB_PDU_DATA_OFF + 2 )
 #define MB_PDU_FUNC_READWRITE_WRITE_ADDR_OFF    ( MB_PDU_DATA_OFF + 4 )
@@ -86,14 +93,18 @@ eMBFuncWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
         usRegAddress++;
 
         /* Make callback to update the value. */
-        eRegStatus = eMBRegHoldingCB( &pucFrame[MB_PDU_FUNC_WRITE_VALUE_OFF],
-                                      usRegAddress, 1, MB_REG_WRITE );
+        eRegStatus = MB_REG_HOLDING_CB( &pucFrame[MB_PDU_FUNC_WRITE_VALUE_OFF],
+                                        usRegAddress, 1, MB_REG_WRITE );
 
         /* If an error occured convert it into a Modbus exception. */
         if( eRegStatus != MB_ENOERR )
         {
             eStatus = prveMBError2Exception( eRegStatus );
         }
+        else
+        {
+            MB_HOOK_WRITE( MB_REG_MAP_HOLDING, usRegAddress, 1 );
+        }
     }
     else
     {
@@ -132,8 +143,8 @@ eMBFuncWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
         {
             /* Make callback to update the register values. */
             eRegStatus =
-                eMBRegHoldingCB( &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
-                                 usRegAddress, usRegCount, MB_REG_WRITE );
+                MB_REG_HOLDING_CB( &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
+                                   usRegAddress, usRegCount, MB_REG_WRITE );
 
             /* If an error occured convert it into a Modbus exception. */
             if( eRegStatus != MB_ENOERR )
@@ -142,6 +153,8 @@ eMBFuncWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
             }
             else
             {
+                MB_HOOK_WRITE( MB_REG_MAP_HOLDING, usRegAddress, usRegCount );
+
                 /* The response contains the function code, the starting
                  * address and the quantity of registers. We reuse the
                  * old values in the buffer because they are still valid.
@@ -163,6 +176,75 @@ eMBFuncWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
 }
 #endif
 
+#if MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0
+
+eMBException
+eMBFuncMaskWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    USHORT          usAndMask;
+    USHORT          usOrMask;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+#if MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED == 0
+    USHORT          usRegValue;
+    UCHAR           ucRegBuffer[2];
+#endif
+
+    if( *usLen == ( MB_PDU_FUNC_MASK_WRITE_SIZE + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_ADDR_OFF] << 8 );
+        usRegAddress |= ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_ADDR_OFF + 1] );
+        usRegAddress++;
+
+        usAndMask = ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_AND_OFF] << 8 );
+        usAndMask |= ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_AND_OFF + 1] );
+
+        usOrMask = ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_OR_OFF] << 8 );
+        usOrMask |= ( USHORT )( pucFrame[MB_PDU_FUNC_MASK_WRITE_OR_OFF + 1] );
+
+#if MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED > 0
+        /* Let the application apply the masks atomically. */
+        eRegStatus = eMBRegHoldingMaskCB( usRegAddress, usAndMask, usOrMask );
+#else
+        /* The register callback is not called within a critical section
+         * because it may block or use the critical section itself. The
+         * read-modify-write cycle is therefore not atomic. Applications
+         * which share the register with other tasks or interrupt handlers
+         * must enable MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED. */
+        eRegStatus = MB_REG_HOLDING_CB( ucRegBuffer, usRegAddress, 1, MB_REG_READ );
+        if( eRegStatus == MB_ENOERR )
+        {
+            usRegValue = ( USHORT )( ucRegBuffer[0] << 8 );
+            usRegValue |= ( USHORT )( ucRegBuffer[1] );
+            usRegValue = ( USHORT )( ( usRegValue & usAndMask ) | ( usOrMask & ~usAndMask ) );
+            ucRegBuffer[0] = ( UCHAR )( usRegValue >> 8 );
+            ucRegBuffer[1] = ( UCHAR )( usRegValue & 0xFF );
+            eRegStatus = MB_REG_HOLDING_CB( ucRegBuffer, usRegAddress, 1, MB_REG_WRITE );
+        }
+#endif
+
+        /* If an error occured convert it into a Modbus exception. The
+         * response is an echo of the request. */
+        if( eRegStatus != MB_ENOERR )
+        {
+            eStatus = prveMBError2Exception( eRegStatus );
+        }
+        else
+        {
+            MB_HOOK_WRITE( MB_REG_MAP_HOLDING, usRegAddress, 1 );
+        }
+    }
+    else
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+#endif
+
 #if MB_FUNC_READ_HOLDING_ENABLED > 0
 
 eMBException
@@ -202,7 +284,7 @@ eMBFuncReadHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
             *usLen += 1;
 
             /* Make callback to fill the buffer. */
-            eRegStatus = eMBRegHoldingCB( pucFrameCur, usRegAddress, usRegCount, MB_REG_READ );
+            eRegStatus = MB_REG_HOLDING_CB( pucFrameCur, usRegAddress, usRegCount, MB_REG_READ );
             /* If an error occured convert it into a Modbus exception. */
             if( eRegStatus != MB_ENOERR )
             {
@@ -266,11 +348,13 @@ eMBFuncReadWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
             ( ( 2 * usRegWriteCount ) == ucRegWriteByteCount ) )
         {
             /* Make callback to update the register values. */
-            eRegStatus = eMBRegHoldingCB( &pucFrame[MB_PDU_FUNC_READWRITE_WRITE_VALUES_OFF],
-                                          usRegWriteAddress, usRegWriteCount, MB_REG_WRITE );
+            eRegStatus = MB_REG_HOLDING_CB( &pucFrame[MB_PDU_FUNC_READWRITE_WRITE_VALUES_OFF],
+                                            usRegWriteAddress, usRegWriteCount, MB_REG_WRITE );
 
             if( eRegStatus == MB_ENOERR )
             {
+                MB_HOOK_WRITE( MB_REG_MAP_HOLDING, usRegWriteAddress, usRegWriteCount );
+
                 /* Set the current PDU data pointer to the beginning. */
                 pucFrameCur = &pucFrame[MB_PDU_FUNC_OFF];
                 *usLen = MB_PDU_FUNC_OFF;
@@ -285,7 +369,7 @@ eMBFuncReadWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
 
                 /* Make the read callback. */
                 eRegStatus =
-                    eMBRegHoldingCB( pucFrameCur, usRegReadAddress, usRegReadCount, MB_REG_READ );
+                    MB_REG_HOLDING_CB( pucFrameCur, usRegReadAddress, usRegReadCount, MB_REG_READ );
                 if( eRegStatus == MB_ENOERR )
                 {
                     *usLen += 2 * usRegReadCount;
@@ -40,13 +40,53 @@
 #include "mbproto.h"
 #include "mbconfig.h"
 
-#if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_FUNC_MEI_TYPE_OFF                ( MB_PDU_DATA_OFF + 0 )
+#define MB_PDU_FUNC_DEVID_CODE_OFF              ( MB_PDU_DATA_OFF + 1 )
+#define MB_PDU_FUNC_DEVID_OBJID_OFF             ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_DEVID_SIZE                  ( 3 )
+#define MB_PDU_FUNC_DEVID_CONFORMITY_OFF        ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_FUNC_DEVID_MORE_OFF              ( MB_PDU_DATA_OFF + 3 )
+#define MB_PDU_FUNC_DEVID_NEXTID_OFF            ( MB_PDU_DATA_OFF + 4 )
+#define MB_PDU_FUNC_DEVID_NOBJ_OFF              ( MB_PDU_DATA_OFF + 5 )
+#define MB_PDU_FUNC_DEVID_OBJECTS_OFF           ( MB_PDU_DATA_OFF + 6 )
+#define MB_PDU_FUNC_DEVID_OBJECTS_MAX           ( MB_PDU_SIZE_MAX - MB_PDU_FUNC_DEVID_OBJECTS_OFF )
+
+#define MB_MEI_READ_DEVICE_ID                   ( 0x0E )
+#define MB_DEVID_CODE_BASIC                     ( 0x01 )
+#define MB_DEVID_CODE_REGULAR                   ( 0x02 )
+#define MB_DEVID_CODE_EXTENDED                  ( 0x03 )
+#define MB_DEVID_CODE_INDIVIDUAL                ( 0x04 )
+#define MB_DEVID_CONFORMITY_INDIVIDUAL          ( 0x80 )
+#define MB_DEVID_MORE_FOLLOWS                   ( 0xFF )
+#define MB_DEVID_OBJID_LAST_BASIC               ( 0x02 )
+#define MB_DEVID_OBJID_LAST_REGULAR             ( 0x7F )
+#define MB_DEVID_OBJID_LAST_EXTENDED            ( 0xFF )
 
 /* ----------------------- Static variables ---------------------------------*/
+#if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
 static UCHAR    ucMBSlaveID[MB_FUNC_OTHER_REP_SLAVEID_BUF];
 static USHORT   usMBSlaveIDLen;
+#endif
+
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+/* The object table is kept in the encoding of the response. The offset of
+ * object i is stored in usMBDeviceIDOffset[i]. The additional entry at the
+ * end holds the length of the table. Therefore the length of any sequence
+ * of objects is the difference of two offsets. */
+static UCHAR const *pucMBDeviceID;
+static USHORT   usMBDeviceIDOffset[MB_FUNC_OTHER_DEVICE_ID_OBJECTS_MAX + 1];
+static UCHAR    ucMBDeviceIDObjects;
+static UCHAR    ucMBDeviceIDConformity;
+#endif
+
+/* ----------------------- Static functions ---------------------------------*/
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+static UCHAR    prvucMBDeviceIDFind( UCHAR ucObjectID );
+#endif
 
 /* ----------------------- Start implementation -----------------------------*/
+#if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
 
 eMBErrorCode
 eMBSetSlaveID( UCHAR ucSlaveID, BOOL xIsRunning,
@@ -85,3 +125,224 @@ eMBFuncReportSlaveID( UCHAR * pucFrame, USHORT * usLen )
 }
 
 #endif
+
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+
+eMBErrorCode
+eMBSetDeviceID( UCHAR const *pucObjects, USHORT usLen )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    USHORT          usOffset = 0;
+    USHORT          usObjectLen;
+    UCHAR           ucObjects = 0;
+    UCHAR           ucLastID;
+
+    /* Disable the function until the new table has been checked. */
+    ucMBDeviceIDObjects = 0;
+    while( ( eStatus == MB_ENOERR ) && ( usOffset < usLen ) )
+    {
+        if( ( usOffset + 2 ) > usLen )
+        {
+            eStatus = MB_EINVAL;
+            break;
+        }
+        usObjectLen = ( USHORT )( 2 + pucObjects[usOffset + 1] );
+
+        /* The object ids must be strictly increasing and every object must
+         * fit into a single response. */
+        if( ( ( ucObjects > 0 ) && ( pucObjects[usOffset] <= ucLastID ) ) ||
+            ( ( usOffset + usObjectLen ) > usLen ) ||
+            ( usObjectLen > MB_PDU_FUNC_DEVID_OBJECTS_MAX ) )
+        {
+            eStatus = MB_EINVAL;
+        }
+        else if( ucObjects == MB_FUNC_OTHER_DEVICE_ID_OBJECTS_MAX )
+        {
+            eStatus = MB_ENORES;
+        }
+        else
+        {
+            ucLastID = pucObjects[usOffset];
+            usMBDeviceIDOffset[ucObjects++] = usOffset;
+            usOffset += usObjectLen;
+        }
+    }
+
+    if( eStatus == MB_ENOERR )
+    {
+        usMBDeviceIDOffset[ucObjects] = usOffset;
+
+        /* The basic objects are mandatory. Because the ids are sorted they
+         * must be the first three objects. */
+        if( ( ucObjects < 3 ) || ( pucObjects[usMBDeviceIDOffset[0]] != 0x00 ) ||
+            ( pucObjects[usMBDeviceIDOffset[1]] != 0x01 ) ||
+            ( pucObjects[usMBDeviceIDOffset[2]] != 0x02 ) )
+        {
+            eStatus = MB_EINVAL;
+        }
+        else
+        {
+            if( ucLastID > MB_DEVID_OBJID_LAST_REGULAR )
+            {
+                ucMBDeviceIDConformity = MB_DEVID_CODE_EXTENDED;
+            }
+            else if( ucLastID > MB_DEVID_OBJID_LAST_BASIC )
+            {
+                ucMBDeviceIDConformity = MB_DEVID_CODE_REGULAR;
+            }
+            else
+            {
+                ucMBDeviceIDConformity = MB_DEVID_CODE_BASIC;
+            }
+            ucMBDeviceIDConformity |= MB_DEVID_CONFORMITY_INDIVIDUAL;
+            pucMBDeviceID = pucObjects;
+            ucMBDeviceIDObjects = ucObjects;
+        }
+    }
+    return eStatus;
+}
+
+eMBException
+eMBFuncEncapInterface( UCHAR * pucFrame, USHORT * usLen )
+{
+    UCHAR           ucReadCode;
+    UCHAR           ucObjectID;
+    UCHAR           ucLastID;
+    UCHAR           ucFirst;
+    UCHAR           ucNext;
+    UCHAR           ucMoreFollows = 0x00;
+    UCHAR           ucNextID = 0x00;
+    USHORT          usBytes;
+    eMBException    eStatus = MB_EX_NONE;
+
+    if( *usLen != ( MB_PDU_FUNC_DEVID_SIZE + MB_PDU_SIZE_MIN ) )
+    {
+        /* Can't be a valid request because the length is incorrect. */
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    else if( ( pucFrame[MB_PDU_FUNC_MEI_TYPE_OFF] != MB_MEI_READ_DEVICE_ID ) ||
+             ( ucMBDeviceIDObjects == 0 ) )
+    {
+        /* Only the Read Device Identification interface is supported. */
+        eStatus = MB_EX_ILLEGAL_FUNCTION;
+    }
+    else
+    {
+        ucReadCode = pucFrame[MB_PDU_FUNC_DEVID_CODE_OFF];
+        ucObjectID = pucFrame[MB_PDU_FUNC_DEVID_OBJID_OFF];
+        ucFirst = prvucMBDeviceIDFind( ucObjectID );
+        ucNext = ucFirst;
+        switch ( ucReadCode )
+        {
+        case MB_DEVID_CODE_INDIVIDUAL:
+            if( ucFirst == ucMBDeviceIDObjects )
+            {
+                eStatus = MB_EX_ILLEGAL_DATA_ADDRESS;
+            }
+            else
+            {
+                ucNext = ( UCHAR )( ucFirst + 1 );
+            }
+            break;
+
+        case MB_DEVID_CODE_BASIC:
+        case MB_DEVID_CODE_REGULAR:
+        case MB_DEVID_CODE_EXTENDED:
+            if( ucReadCode == MB_DEVID_CODE_BASIC )
+            {
+                ucLastID = MB_DEVID_OBJID_LAST_BASIC;
+            }
+            else if( ucReadCode == MB_DEVID_CODE_REGULAR )
+            {
+                ucLastID = MB_DEVID_OBJID_LAST_REGULAR;
+            }
+            else
+            {
+                ucLastID = MB_DEVID_OBJID_LAST_EXTENDED;
+            }
+
+            /* An unknown object id restarts the stream at the beginning. */
+            if( ( ucFirst == ucMBDeviceIDObjects ) || ( ucObjectID > ucLastID ) )
+            {
+                ucFirst = 0;
+            }
+            ucNext = ucFirst;
+
+            /* Add objects of the category as long as they fit into the
+             * response. The remaining ones are announced with the
+             * more follows flag. */
+            while( ( ucNext < ucMBDeviceIDObjects ) &&
+                   ( pucMBDeviceID[usMBDeviceIDOffset[ucNext]] <= ucLastID ) &&
+                   ( ( usMBDeviceIDOffset[ucNext + 1] - usMBDeviceIDOffset[ucFirst] ) <=
+                     MB_PDU_FUNC_DEVID_OBJECTS_MAX ) )
+            {
+                ucNext++;
+            }
+            if( ( ucNext < ucMBDeviceIDObjects ) &&
+                ( pucMBDeviceID[usMBDeviceIDOffset[ucNext]] <= ucLastID ) )
+            {
+                ucMoreFollows = MB_DEVID_MORE_FOLLOWS;
+                ucNextID = pucMBDeviceID[usMBDeviceIDOffset[ucNext]];
+            }
+            break;
+
+        default:
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+            break;
+        }
+
+        /* The objects must never exceed the space left in the PDU. */
+        if( ( eStatus == MB_EX_NONE ) &&
+            ( ( usMBDeviceIDOffset[ucNext] - usMBDeviceIDOffset[ucFirst] ) > MB_PDU_FUNC_DEVID_OBJECTS_MAX ) )
+        {
+            eStatus = MB_EX_SLAVE_DEVICE_FAILURE;
+        }
+
+        if( eStatus == MB_EX_NONE )
+        {
+            pucFrame[MB_PDU_FUNC_DEVID_CONFORMITY_OFF] = ucMBDeviceIDConformity;
+            pucFrame[MB_PDU_FUNC_DEVID_MORE_OFF] = ucMoreFollows;
+            pucFrame[MB_PDU_FUNC_DEVID_NEXTID_OFF] = ucNextID;
+            pucFrame[MB_PDU_FUNC_DEVID_NOBJ_OFF] = ( UCHAR )( ucNext - ucFirst );
+
+            /* The objects are stored in the encoding of the response and
+             * are therefore copied in one step. */
+            usBytes = ( USHORT )( usMBDeviceIDOffset[ucNext] - usMBDeviceIDOffset[ucFirst] );
+            memcpy( &pucFrame[MB_PDU_FUNC_DEVID_OBJECTS_OFF],
+                    &pucMBDeviceID[usMBDeviceIDOffset[ucFirst]], ( size_t )usBytes );
+            *usLen = ( USHORT )( MB_PDU_FUNC_DEVID_OBJECTS_OFF + usBytes );
+        }
+    }
+    return eStatus;
+}
+
+static          UCHAR
+prvucMBDeviceIDFind( UCHAR ucObjectID )
+{
+    UCHAR           ucLow = 0;
+    UCHAR           ucHigh = ucMBDeviceIDObjects;
+    UCHAR           ucMid;
+
+    /* Binary search on the sorted object ids. Returns the number of objects
+     * if the object id is not known. */
+    while( ucLow < ucHigh )
+    {
+        ucMid = ( UCHAR )( ( ucLow + ucHigh ) / 2 );
+        if( pucMBDeviceID[usMBDeviceIDOffset[ucMid]] < ucObjectID )
+        {
+            ucLow = ( UCHAR )( ucMid + 1 );
+        }
+        else
+        {
+            ucHigh = ucMid;
+        }
+    }
+    if( ( ucLow < ucMBDeviceIDObjects ) &&
+        ( pucMBDeviceID[usMBDeviceIDOffset[ucLow]] != ucObjectID ) )
+    {
+        ucLow = ucMBDeviceIDObjects;
+    }
+    return ucLow;
+}
+
+#endif
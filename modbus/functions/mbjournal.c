@@ -0,0 +1,152 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbatomic.h"
+#include "mbjournal.h"
+
+#if MB_JOURNAL_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_JOURNAL_MASK             ( ( ULONG )MB_JOURNAL_SIZE - 1 )
+
+/* The state of a slot for the position ulPos. The lap is the position
+ * without the index of the slot, so a zero initialized slot is free for the
+ * first lap. A consumed slot becomes free for the next lap. */
+#define MB_JOURNAL_FREE( ulPos )        ( ( ulPos ) & ~MB_JOURNAL_MASK )
+#define MB_JOURNAL_PUBLISHED( ulPos )   ( MB_JOURNAL_FREE( ulPos ) + 1 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    volatile ULONG  ulState;
+    xMBJournalRecord xRecord;
+} xMBJournalSlot;
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBJournalSlot xMBJournal[MB_JOURNAL_SIZE];
+static volatile ULONG ulMBJournalHead;
+static ULONG    ulMBJournalTail;
+static volatile ULONG ulMBJournalDropped;
+static ULONG    ulMBJournalDroppedSeen;
+
+/* ----------------------- Start implementation -----------------------------*/
+void
+vMBJournalAppend( eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs )
+{
+    xMBJournalSlot *pxSlot = NULL;
+    ULONG           ulPos;
+    ULONG           ulState;
+    BOOL            xClaimed = FALSE;
+    BOOL            xFull = FALSE;
+
+    assert( ( MB_JOURNAL_SIZE & MB_JOURNAL_MASK ) == 0 );
+
+    /* Claim the slot at the head. If another producer was faster the head
+     * has moved and we try again with the next slot. */
+    MB_ATOMIC_LOAD_ACQUIRE( &ulMBJournalHead, ulPos );
+    while( !xClaimed && !xFull )
+    {
+        pxSlot = &xMBJournal[ulPos & MB_JOURNAL_MASK];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxSlot->ulState, ulState );
+        if( ulState == MB_JOURNAL_FREE( ulPos ) )
+        {
+            MB_ATOMIC_CAS( &ulMBJournalHead, ulPos, ulPos + 1, xClaimed );
+            if( !xClaimed )
+            {
+                MB_ATOMIC_LOAD_ACQUIRE( &ulMBJournalHead, ulPos );
+            }
+        }
+        else if( ( LONG )( ulState - MB_JOURNAL_FREE( ulPos ) ) < 0 )
+        {
+            /* The record of the previous lap has not been consumed. */
+            xFull = TRUE;
+        }
+        else
+        {
+            MB_ATOMIC_LOAD_ACQUIRE( &ulMBJournalHead, ulPos );
+        }
+    }
+
+    if( xClaimed )
+    {
+        pxSlot->xRecord.ulSequence = ulPos;
+        pxSlot->xRecord.eTable = eTable;
+        pxSlot->xRecord.usAddress = usAddress;
+        pxSlot->xRecord.usNRegs = usNRegs;
+        MB_ATOMIC_STORE_RELEASE( &pxSlot->ulState, MB_JOURNAL_PUBLISHED( ulPos ) );
+    }
+    else
+    {
+        MB_ATOMIC_FETCH_ADD( &ulMBJournalDropped, 1 );
+    }
+}
+
+USHORT
+usMBJournalDrain( xMBJournalRecord * pxRecords, USHORT usMax, BOOL * pxOverflow )
+{
+    xMBJournalSlot *pxSlot;
+    ULONG           ulState;
+    ULONG           ulDropped;
+    USHORT          usN = 0;
+    BOOL            xEmpty = FALSE;
+
+    while( !xEmpty && ( usN < usMax ) )
+    {
+        pxSlot = &xMBJournal[ulMBJournalTail & MB_JOURNAL_MASK];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxSlot->ulState, ulState );
+        if( ulState == MB_JOURNAL_PUBLISHED( ulMBJournalTail ) )
+        {
+            pxRecords[usN++] = pxSlot->xRecord;
+            MB_ATOMIC_STORE_RELEASE( &pxSlot->ulState,
+                                     MB_JOURNAL_FREE( ulMBJournalTail ) + MB_JOURNAL_SIZE );
+            ulMBJournalTail++;
+        }
+        else
+        {
+            xEmpty = TRUE;
+        }
+    }
+
+    MB_ATOMIC_LOAD_ACQUIRE( &ulMBJournalDropped, ulDropped );
+    *pxOverflow = ( ulDropped != ulMBJournalDroppedSeen ) ? TRUE : FALSE;
+    ulMBJournalDroppedSeen = ulDropped;
+    return usN;
+}
+
+#endif
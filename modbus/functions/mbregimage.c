@@ -0,0 +1,186 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbatomic.h"
+#include "mbutils.h"
+#include "mbregimage.h"
+
+#if MB_REG_IMAGE_ENABLED > 0
+
+/* ----------------------- Static functions ---------------------------------*/
+static eMBErrorCode prveMBRegImageSnapshot( xMBRegImage * pxImage, USHORT usOffset,
+                                            USHORT usNRegs, USHORT * pusValues,
+                                            UCHAR * pucRegBuffer );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBRegImageInit( xMBRegImage * pxImage, USHORT * pusRegs, USHORT usNRegs )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( ( pxImage == NULL ) || ( pusRegs == NULL ) || ( usNRegs == 0 ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        pxImage->ulSequence = 0;
+        pxImage->ulLock = 0;
+        pxImage->pusRegs = pusRegs;
+        pxImage->usNRegs = usNRegs;
+    }
+    return eStatus;
+}
+
+void
+vMBRegImageBeginWrite( xMBRegImage * pxImage )
+{
+    MB_ATOMIC_LOCK( &pxImage->ulLock );
+    /* Only writers change the sequence number and they are serialized by
+     * the lock. The fence keeps the changes of the registers behind the odd
+     * sequence number. */
+    MB_ATOMIC_STORE_RELEASE( &pxImage->ulSequence, pxImage->ulSequence + 1 );
+    MB_ATOMIC_FENCE_RELEASE(  );
+}
+
+void
+vMBRegImageEndWrite( xMBRegImage * pxImage )
+{
+    MB_ATOMIC_STORE_RELEASE( &pxImage->ulSequence, pxImage->ulSequence + 1 );
+    MB_ATOMIC_UNLOCK( &pxImage->ulLock );
+}
+
+eMBErrorCode
+eMBRegImageWrite( xMBRegImage * pxImage, USHORT usOffset, const USHORT * pusValues, USHORT usNRegs )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( ( ( ULONG )usOffset + usNRegs ) > pxImage->usNRegs )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        vMBRegImageBeginWrite( pxImage );
+        memcpy( &pxImage->pusRegs[usOffset], pusValues, ( size_t )usNRegs * sizeof( USHORT ) );
+        vMBRegImageEndWrite( pxImage );
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBRegImageRead( xMBRegImage * pxImage, USHORT usOffset, USHORT * pusValues, USHORT usNRegs )
+{
+    return prveMBRegImageSnapshot( pxImage, usOffset, usNRegs, pusValues, NULL );
+}
+
+eMBErrorCode
+eMBRegImageAccess( xMBRegImage * pxImage, UCHAR * pucRegBuffer, USHORT usOffset,
+                   USHORT usNRegs, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( eMode == MB_REG_READ )
+    {
+        eStatus = prveMBRegImageSnapshot( pxImage, usOffset, usNRegs, NULL, pucRegBuffer );
+    }
+    else if( ( ( ULONG )usOffset + usNRegs ) > pxImage->usNRegs )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        vMBRegImageBeginWrite( pxImage );
+        vMBUtilCopyRegsFromPDU( &pxImage->pusRegs[usOffset], pucRegBuffer, usNRegs );
+        vMBRegImageEndWrite( pxImage );
+    }
+    return eStatus;
+}
+
+static          eMBErrorCode
+prveMBRegImageSnapshot( xMBRegImage * pxImage, USHORT usOffset, USHORT usNRegs,
+                        USHORT * pusValues, UCHAR * pucRegBuffer )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    ULONG           ulBefore;
+    ULONG           ulAfter;
+    USHORT          usRetries = 0;
+
+    if( ( ( ULONG )usOffset + usNRegs ) > pxImage->usNRegs )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        do
+        {
+            MB_ATOMIC_LOAD_ACQUIRE( &pxImage->ulSequence, ulBefore );
+            if( ( ulBefore & 1 ) == 0 )
+            {
+                /* The copy can see a partial update. It is discarded if the
+                 * sequence number has changed afterwards. */
+                if( pusValues != NULL )
+                {
+                    memcpy( pusValues, &pxImage->pusRegs[usOffset], ( size_t )usNRegs * sizeof( USHORT ) );
+                }
+                else
+                {
+                    vMBUtilCopyRegsToPDU( pucRegBuffer, &pxImage->pusRegs[usOffset], usNRegs );
+                }
+                MB_ATOMIC_FENCE_ACQUIRE(  );
+                MB_ATOMIC_LOAD_ACQUIRE( &pxImage->ulSequence, ulAfter );
+            }
+            else
+            {
+                /* A writer is active. */
+                ulAfter = ulBefore + 1;
+            }
+            usRetries++;
+        }
+        while( ( ulBefore != ulAfter ) && ( usRetries < MB_REG_IMAGE_READ_RETRIES ) );
+
+        if( ulBefore != ulAfter )
+        {
+            eStatus = MB_ETIMEDOUT;
+        }
+    }
+    return eStatus;
+}
+
+#endif
@@ -0,0 +1,334 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbutils.h"
+#include "mbregmap.h"
+#include "mbregimage.h"
+
+#if MB_REG_MAP_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+/* Bits of dynamic coil and discrete ranges are passed to the callbacks
+ * through a temporary buffer in chunks of this size. */
+#define MB_REG_MAP_BITS_CHUNK       ( 64 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef         eMBErrorCode( *peMBRegMapCallback ) ( UCHAR * pucRegBuffer, USHORT usAddress,
+                                                      USHORT usNRegs, eMBRegisterMode eMode );
+
+/* ----------------------- Static variables ---------------------------------*/
+static const xMBRegMapRange *pxMBRegMaps[MB_REG_MAP_TABLES];
+static USHORT   usMBRegMapRanges[MB_REG_MAP_TABLES];
+
+/* ----------------------- Static functions ---------------------------------*/
+static eMBErrorCode prveMBRegMapAccess( eMBRegMapTable eTable, peMBRegMapCallback peCallback,
+                                        UCHAR * pucRegBuffer, USHORT usAddress,
+                                        USHORT usNRegs, eMBRegisterMode eMode );
+static const xMBRegMapRange *prvpxMBRegMapFind( eMBRegMapTable eTable, USHORT usAddress );
+static const xMBRegMapRange *prvpxMBRegMapNext( eMBRegMapTable eTable,
+                                                const xMBRegMapRange * pxRange, USHORT usAddress );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBRegMapSet( eMBRegMapTable eTable, const xMBRegMapRange * pxRanges, USHORT usNRanges )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    USHORT          usIdx;
+
+    if( ( eTable >= MB_REG_MAP_TABLES ) || ( ( pxRanges == NULL ) && ( usNRanges > 0 ) ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        for( usIdx = 0; usIdx < usNRanges; usIdx++ )
+        {
+            if( ( pxRanges[usIdx].usAddress == 0 ) || ( pxRanges[usIdx].usNRegs == 0 ) ||
+                ( ( ( ULONG )pxRanges[usIdx].usAddress + pxRanges[usIdx].usNRegs ) > 0x10000UL ) ||
+                ( ( pxRanges[usIdx].pvData == NULL ) &&
+                  ( ( pxRanges[usIdx].ucFlags & MB_REG_MAP_DYNAMIC ) == 0 ) ) ||
+                ( ( ( pxRanges[usIdx].ucFlags & MB_REG_MAP_IMAGE ) != 0 ) &&
+                  ( ( MB_REG_IMAGE_ENABLED == 0 ) || ( eTable == MB_REG_MAP_COILS ) ||
+                    ( eTable == MB_REG_MAP_DISCRETE ) ) ) ||
+                ( ( usIdx > 0 ) &&
+                  ( ( ( ULONG )pxRanges[usIdx - 1].usAddress + pxRanges[usIdx - 1].usNRegs ) >
+                    pxRanges[usIdx].usAddress ) ) )
+            {
+                eStatus = MB_EINVAL;
+                break;
+            }
+        }
+    }
+    if( eStatus == MB_ENOERR )
+    {
+        pxMBRegMaps[eTable] = ( usNRanges > 0 ) ? pxRanges : NULL;
+        usMBRegMapRanges[eTable] = usNRanges;
+    }
+    return eStatus;
+}
+
+#if MB_REG_MAP_HOLDING_USED
+eMBErrorCode
+eMBRegMapHolding( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
+{
+    return prveMBRegMapAccess( MB_REG_MAP_HOLDING, eMBRegHoldingCB, pucRegBuffer,
+                               usAddress, usNRegs, eMode );
+}
+#endif
+
+#if MB_REG_MAP_INPUT_USED
+static          eMBErrorCode
+prveMBRegMapInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
+{
+    ( void )eMode;
+    return eMBRegInputCB( pucRegBuffer, usAddress, usNRegs );
+}
+
+eMBErrorCode
+eMBRegMapInput( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+{
+    return prveMBRegMapAccess( MB_REG_MAP_INPUT, prveMBRegMapInputCB, pucRegBuffer,
+                               usAddress, usNRegs, MB_REG_READ );
+}
+#endif
+
+#if MB_REG_MAP_COILS_USED
+eMBErrorCode
+eMBRegMapCoils( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNCoils, eMBRegisterMode eMode )
+{
+    return prveMBRegMapAccess( MB_REG_MAP_COILS, eMBRegCoilsCB, pucRegBuffer,
+                               usAddress, usNCoils, eMode );
+}
+#endif
+
+#if MB_REG_MAP_DISCRETE_USED
+static          eMBErrorCode
+prveMBRegMapDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete,
+                        eMBRegisterMode eMode )
+{
+    ( void )eMode;
+    return eMBRegDiscreteCB( pucRegBuffer, usAddress, usNDiscrete );
+}
+
+eMBErrorCode
+eMBRegMapDiscrete( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete )
+{
+    return prveMBRegMapAccess( MB_REG_MAP_DISCRETE, prveMBRegMapDiscreteCB, pucRegBuffer,
+                               usAddress, usNDiscrete, MB_REG_READ );
+}
+#endif
+
+static          eMBErrorCode
+prveMBRegMapAccess( eMBRegMapTable eTable, peMBRegMapCallback peCallback,
+                    UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs,
+                    eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    const xMBRegMapRange *pxRange;
+    BOOL            xIsBits = ( eTable == MB_REG_MAP_COILS ) || ( eTable == MB_REG_MAP_DISCRETE );
+    UCHAR           ucRequired = ( eMode == MB_REG_WRITE ) ? MB_REG_MAP_WRITE : MB_REG_MAP_READ;
+    UCHAR           ucChunk[MB_REG_MAP_BITS_CHUNK / 8 + 2];
+    USHORT          usCur;
+    USHORT          usDone;
+    USHORT          usN;
+    USHORT          usChunk;
+    USHORT          usOffset;
+    USHORT          usIdx;
+    USHORT         *pusData;
+    UCHAR          *pucBuf;
+
+    if( pxMBRegMaps[eTable] == NULL )
+    {
+        /* Nothing mapped. Keep the behaviour without a register map. */
+        eStatus = peCallback( pucRegBuffer, usAddress, usNRegs, eMode );
+    }
+    else
+    {
+        /* Check that the whole request is mapped before anything is copied.
+         * Otherwise a failed write could be applied partially. */
+        pxRange = NULL;
+        for( usDone = 0; usDone < usNRegs; usDone += usN )
+        {
+            usCur = ( USHORT )( usAddress + usDone );
+            pxRange = prvpxMBRegMapNext( eTable, pxRange, usCur );
+            if( ( pxRange == NULL ) || ( ( pxRange->ucFlags & ucRequired ) == 0 ) )
+            {
+                eStatus = MB_ENOREG;
+                break;
+            }
+            usN = ( USHORT )( pxRange->usAddress + pxRange->usNRegs - usCur );
+            if( usN > ( usNRegs - usDone ) )
+            {
+                usN = ( USHORT )( usNRegs - usDone );
+            }
+        }
+
+        /* The callbacks for coils and discrete inputs set the unused bits of
+         * the last byte to zero. Do the same for mapped bits. */
+        if( ( eStatus == MB_ENOERR ) && xIsBits && ( eMode == MB_REG_READ ) )
+        {
+            memset( pucRegBuffer, 0, ( size_t )( ( usNRegs + 7 ) / 8 ) );
+        }
+
+        pxRange = NULL;
+        for( usDone = 0; ( eStatus == MB_ENOERR ) && ( usDone < usNRegs ); usDone += usN )
+        {
+            usCur = ( USHORT )( usAddress + usDone );
+            pxRange = prvpxMBRegMapNext( eTable, pxRange, usCur );
+            usOffset = ( USHORT )( usCur - pxRange->usAddress );
+            usN = ( USHORT )( pxRange->usNRegs - usOffset );
+            if( usN > ( usNRegs - usDone ) )
+            {
+                usN = ( USHORT )( usNRegs - usDone );
+            }
+
+            if( !xIsBits )
+            {
+                pucBuf = &pucRegBuffer[usDone * 2];
+                if( pxRange->ucFlags & MB_REG_MAP_DYNAMIC )
+                {
+                    eStatus = peCallback( pucBuf, usCur, usN, eMode );
+                }
+#if MB_REG_IMAGE_ENABLED > 0
+                else if( pxRange->ucFlags & MB_REG_MAP_IMAGE )
+                {
+                    eStatus = eMBRegImageAccess( ( xMBRegImage * ) pxRange->pvData, pucBuf, usOffset, usN, eMode );
+                }
+#endif
+                else
+                {
+                    pusData = ( USHORT * )pxRange->pvData + usOffset;
+                    if( eMode == MB_REG_READ )
+                    {
+                        vMBUtilCopyRegsToPDU( pucBuf, pusData, usN );
+                    }
+                    else
+                    {
+                        vMBUtilCopyRegsFromPDU( pusData, pucBuf, usN );
+                    }
+                }
+            }
+            else if( pxRange->ucFlags & MB_REG_MAP_DYNAMIC )
+            {
+                /* The callbacks expect the first bit in the LSB of the first
+                 * byte. Therefore the bits are passed in aligned chunks. */
+                for( usIdx = 0; ( eStatus == MB_ENOERR ) && ( usIdx < usN ); usIdx += usChunk )
+                {
+                    usChunk = ( USHORT )( usN - usIdx );
+                    if( usChunk > MB_REG_MAP_BITS_CHUNK )
+                    {
+                        usChunk = MB_REG_MAP_BITS_CHUNK;
+                    }
+                    memset( ucChunk, 0, sizeof( ucChunk ) );
+                    if( eMode == MB_REG_WRITE )
+                    {
+                        vMBUtilCopyBits( ucChunk, 0, pucRegBuffer, ( USHORT )( usDone + usIdx ), usChunk );
+                    }
+                    eStatus = peCallback( ucChunk, ( USHORT )( usCur + usIdx ), usChunk, eMode );
+                    if( ( eStatus == MB_ENOERR ) && ( eMode == MB_REG_READ ) )
+                    {
+                        vMBUtilCopyBits( pucRegBuffer, ( USHORT )( usDone + usIdx ), ucChunk, 0, usChunk );
+                    }
+                }
+            }
+            else if( eMode == MB_REG_READ )
+            {
+                vMBUtilCopyBits( pucRegBuffer, usDone, ( UCHAR * )pxRange->pvData, usOffset, usN );
+            }
+            else
+            {
+                vMBUtilCopyBits( ( UCHAR * )pxRange->pvData, usOffset, pucRegBuffer, usDone, usN );
+            }
+        }
+    }
+    return eStatus;
+}
+
+static const xMBRegMapRange *
+prvpxMBRegMapFind( eMBRegMapTable eTable, USHORT usAddress )
+{
+    const xMBRegMapRange *pxRanges = pxMBRegMaps[eTable];
+    const xMBRegMapRange *pxFound = NULL;
+    USHORT          usLow = 0;
+    USHORT          usHigh = usMBRegMapRanges[eTable];
+    USHORT          usMid;
+
+    /* The ranges are sorted and disjoint. Search the first range which
+     * starts after the address. The range before it is the only one which
+     * can contain the address. */
+    while( usLow < usHigh )
+    {
+        usMid = ( USHORT )( usLow + ( usHigh - usLow ) / 2 );
+        if( pxRanges[usMid].usAddress <= usAddress )
+        {
+            usLow = ( USHORT )( usMid + 1 );
+        }
+        else
+        {
+            usHigh = usMid;
+        }
+    }
+    if( ( usLow > 0 ) &&
+        ( ( ULONG )usAddress < ( ( ULONG )pxRanges[usLow - 1].usAddress + pxRanges[usLow - 1].usNRegs ) ) )
+    {
+        pxFound = &pxRanges[usLow - 1];
+    }
+    return pxFound;
+}
+
+static const xMBRegMapRange *
+prvpxMBRegMapNext( eMBRegMapTable eTable, const xMBRegMapRange * pxRange, USHORT usAddress )
+{
+    const xMBRegMapRange *pxNext = NULL;
+
+    if( pxRange == NULL )
+    {
+        pxNext = prvpxMBRegMapFind( eTable, usAddress );
+    }
+    else if( ( pxRange + 1 < pxMBRegMaps[eTable] + usMBRegMapRanges[eTable] ) &&
+             ( pxRange[1].usAddress == usAddress ) )
+    {
+        /* A request continues in the following range. Otherwise there is a
+         * gap in the map. */
+        pxNext = pxRange + 1;
+    }
+    return pxNext;
+}
+
+#endif
@@ -0,0 +1,279 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbatomic.h"
+#include "mbregmap.h"
+#include "mbsubscribe.h"
+
+#if MB_SUBSCRIBE_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_SUBSCRIBE_BITS( eTable ) \
+    ( ( ( eTable ) == MB_REG_MAP_COILS ) || ( ( eTable ) == MB_REG_MAP_DISCRETE ) )
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBSubscription *pxMBSubscriptions[MB_SUBSCRIBE_MAX];
+static UCHAR    ucMBSubscribeBuf[MB_SUBSCRIBE_REGS_MAX * 2];
+static volatile UCHAR ucMBSubscribeChanged;    /* Any subscription marked. */
+
+/* ----------------------- Static functions ---------------------------------*/
+static eMBErrorCode prveMBSubscriptionRead( eMBRegMapTable eTable, UCHAR * pucBuf,
+                                            USHORT usAddress, USHORT usNRegs );
+static BOOL     prvxMBSubscriptionUpdate( xMBSubscription * pxSub, const UCHAR * pucBuf );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBSubscribe( xMBSubscription * pxSub, eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs,
+              USHORT usDeadband, UCHAR ucFlags, UCHAR * pucLast, pvMBSubscriptionCB pvCallback,
+              void *pvArg )
+{
+    eMBErrorCode    eStatus = MB_ENORES;
+    USHORT          usIdx;
+
+    for( usIdx = 0; usIdx < MB_SUBSCRIBE_MAX; usIdx++ )
+    {
+        if( ( pxSub != NULL ) && ( pxMBSubscriptions[usIdx] == pxSub ) )
+        {
+            pxSub = NULL;
+        }
+    }
+    if( ( pxSub == NULL ) || ( pucLast == NULL ) || ( pvCallback == NULL ) || ( usAddress == 0 ) ||
+        ( usNRegs == 0 ) || ( ( ( ULONG )usAddress + usNRegs ) > 0x10000UL ) ||
+        ( usNRegs > ( MB_SUBSCRIBE_BITS( eTable ) ? MB_SUBSCRIBE_REGS_MAX * 16 : MB_SUBSCRIBE_REGS_MAX ) ) ||
+        ( prveMBSubscriptionRead( eTable, NULL, 0, 0 ) == MB_EINVAL ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        pxSub->eTable = eTable;
+        pxSub->usAddress = usAddress;
+        pxSub->usNRegs = usNRegs;
+        pxSub->usDeadband = usDeadband;
+        pxSub->ucFlags = ucFlags;
+        pxSub->pucLast = pucLast;
+        pxSub->pvCallback = pvCallback;
+        pxSub->pvArg = pvArg;
+        pxSub->ucDirty = 0;
+        pxSub->xValid = FALSE;
+        for( usIdx = 0; usIdx < MB_SUBSCRIBE_MAX; usIdx++ )
+        {
+            if( pxMBSubscriptions[usIdx] == NULL )
+            {
+                pxMBSubscriptions[usIdx] = pxSub;
+                /* Report the initial values. */
+                MB_ATOMIC_STORE_RELEASE( &ucMBSubscribeChanged, 1 );
+                eStatus = MB_ENOERR;
+                break;
+            }
+        }
+    }
+    return eStatus;
+}
+
+void
+vMBUnsubscribe( xMBSubscription * pxSub )
+{
+    USHORT          usIdx;
+
+    for( usIdx = 0; usIdx < MB_SUBSCRIBE_MAX; usIdx++ )
+    {
+        if( pxMBSubscriptions[usIdx] == pxSub )
+        {
+            pxMBSubscriptions[usIdx] = NULL;
+        }
+    }
+}
+
+void
+vMBSubscriptionNotify( eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs )
+{
+    xMBSubscription *pxSub;
+    USHORT          usIdx;
+
+    for( usIdx = 0; usIdx < MB_SUBSCRIBE_MAX; usIdx++ )
+    {
+        pxSub = pxMBSubscriptions[usIdx];
+        if( ( pxSub != NULL ) && ( pxSub->eTable == eTable ) &&
+            ( ( ULONG )usAddress < ( ULONG )pxSub->usAddress + pxSub->usNRegs ) &&
+            ( ( ULONG )pxSub->usAddress < ( ULONG )usAddress + usNRegs ) )
+        {
+            MB_ATOMIC_STORE_RELEASE( &pxSub->ucDirty, 1 );
+            MB_ATOMIC_STORE_RELEASE( &ucMBSubscribeChanged, 1 );
+        }
+    }
+}
+
+void
+vMBSubscriptionDispatch( void )
+{
+    xMBSubscription *pxSub;
+    USHORT          usIdx;
+    UCHAR           ucDirty;
+
+    /* Cleared first like the flags of the subscriptions. */
+    MB_ATOMIC_STORE_RELEASE( &ucMBSubscribeChanged, 0 );
+    for( usIdx = 0; usIdx < MB_SUBSCRIBE_MAX; usIdx++ )
+    {
+        pxSub = pxMBSubscriptions[usIdx];
+        if( pxSub != NULL )
+        {
+            MB_ATOMIC_LOAD_ACQUIRE( &pxSub->ucDirty, ucDirty );
+            if( ucDirty || !pxSub->xValid || ( pxSub->ucFlags & MB_SUBSCRIBE_POLL ) )
+            {
+                /* Clear the flag first. A change during the read marks the
+                 * subscription again. */
+                MB_ATOMIC_STORE_RELEASE( &pxSub->ucDirty, 0 );
+                if( ( prveMBSubscriptionRead( pxSub->eTable, ucMBSubscribeBuf, pxSub->usAddress,
+                                              pxSub->usNRegs ) == MB_ENOERR ) &&
+                    prvxMBSubscriptionUpdate( pxSub, ucMBSubscribeBuf ) )
+                {
+                    pxSub->pvCallback( pxSub, ucMBSubscribeBuf );
+                }
+            }
+        }
+    }
+}
+
+void
+vMBSubscriptionDispatchChanged( void )
+{
+    UCHAR           ucChanged;
+
+    MB_ATOMIC_LOAD_ACQUIRE( &ucMBSubscribeChanged, ucChanged );
+    if( ucChanged )
+    {
+        vMBSubscriptionDispatch(  );
+    }
+}
+
+static          BOOL
+prvxMBSubscriptionUpdate( xMBSubscription * pxSub, const UCHAR * pucBuf )
+{
+    BOOL            xChanged = FALSE;
+    USHORT          usIdx;
+    USHORT          usNew;
+    USHORT          usOld;
+    LONG            lDiff;
+
+    if( MB_SUBSCRIBE_BITS( pxSub->eTable ) )
+    {
+        if( !pxSub->xValid || ( memcmp( pxSub->pucLast, pucBuf, ( size_t )( ( pxSub->usNRegs + 7 ) / 8 ) ) != 0 ) )
+        {
+            memcpy( pxSub->pucLast, pucBuf, ( size_t )( ( pxSub->usNRegs + 7 ) / 8 ) );
+            xChanged = TRUE;
+        }
+    }
+    else
+    {
+        for( usIdx = 0; usIdx < pxSub->usNRegs; usIdx++ )
+        {
+            usNew = ( USHORT )( ( pucBuf[usIdx * 2] << 8 ) | pucBuf[usIdx * 2 + 1] );
+            usOld = ( USHORT )( ( pxSub->pucLast[usIdx * 2] << 8 ) | pxSub->pucLast[usIdx * 2 + 1] );
+            if( pxSub->ucFlags & MB_SUBSCRIBE_SIGNED )
+            {
+                lDiff = ( LONG )( SHORT )usNew - ( LONG )( SHORT )usOld;
+            }
+            else
+            {
+                lDiff = ( LONG )usNew - ( LONG )usOld;
+            }
+            /* Only the registers outside of the deadband are updated.
+             * Otherwise a slow drift would never be reported. */
+            if( !pxSub->xValid || ( labs( lDiff ) > ( LONG )pxSub->usDeadband ) )
+            {
+                pxSub->pucLast[usIdx * 2] = pucBuf[usIdx * 2];
+                pxSub->pucLast[usIdx * 2 + 1] = pucBuf[usIdx * 2 + 1];
+                xChanged = TRUE;
+            }
+        }
+    }
+    pxSub->xValid = TRUE;
+    return xChanged;
+}
+
+/* Read values with the callback of the table. If pucBuf is NULL only check
+ * if the callback is available. */
+static          eMBErrorCode
+prveMBSubscriptionRead( eMBRegMapTable eTable, UCHAR * pucBuf, USHORT usAddress, USHORT usNRegs )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    switch ( eTable )
+    {
+#if MB_REG_MAP_HOLDING_USED
+    case MB_REG_MAP_HOLDING:
+        if( pucBuf != NULL )
+        {
+            eStatus = MB_REG_HOLDING_CB( pucBuf, usAddress, usNRegs, MB_REG_READ );
+        }
+        break;
+#endif
+#if MB_REG_MAP_INPUT_USED
+    case MB_REG_MAP_INPUT:
+        if( pucBuf != NULL )
+        {
+            eStatus = MB_REG_INPUT_CB( pucBuf, usAddress, usNRegs );
+        }
+        break;
+#endif
+#if MB_REG_MAP_COILS_USED
+    case MB_REG_MAP_COILS:
+        if( pucBuf != NULL )
+        {
+            eStatus = MB_REG_COILS_CB( pucBuf, usAddress, usNRegs, MB_REG_READ );
+        }
+        break;
+#endif
+#if MB_REG_MAP_DISCRETE_USED
+    case MB_REG_MAP_DISCRETE:
+        if( pucBuf != NULL )
+        {
+            eStatus = MB_REG_DISCRETE_CB( pucBuf, usAddress, usNRegs );
+        }
+        break;
+#endif
+    default:
+        eStatus = MB_EINVAL;
+        break;
+    }
+    return eStatus;
+}
+
+#endif
@@ -37,10 +37,45 @@
 /* ----------------------- Modbus includes ----------------------------------*/
 #include "mb.h"
 #include "mbproto.h"
+#include "mbconfig.h"
 
 /* ----------------------- Defines ------------------------------------------*/
 #define BITS_UCHAR      8U
 
+/* Select the kernel for the register copy functions. Registers are stored
+ * in big endian byte order in the PDU. On big endian hosts this is a plain
+ * copy. On little endian hosts the bytes of each register are swapped
+ * using vector instructions where available. If the byte order of the host
+ * is not known the registers are converted by value. */
+#if defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ )
+#define MB_UTIL_HOST_BIG_ENDIAN
+#elif defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+#define MB_UTIL_HOST_LITTLE_ENDIAN
+#if ( MB_UTIL_COPY_REGS_SIMD_ENABLED > 0 ) && defined( __AVX2__ )
+#include <immintrin.h>
+#define MB_UTIL_SWAP_AVX2
+#define MB_UTIL_SWAP_SSE2
+#elif ( MB_UTIL_COPY_REGS_SIMD_ENABLED > 0 ) && defined( __SSE2__ )
+#include <emmintrin.h>
+#define MB_UTIL_SWAP_SSE2
+#elif ( MB_UTIL_COPY_REGS_SIMD_ENABLED > 0 ) && defined( __ARM_NEON )
+#include <arm_neon.h>
+#define MB_UTIL_SWAP_NEON
+#elif defined( __SIZEOF_INT__ ) && ( __SIZEOF_INT__ == 4 )
+#define MB_UTIL_SWAP_WORD
+#endif
+#if defined( __SIZEOF_INT__ ) && ( __SIZEOF_INT__ == 4 )
+#define MB_UTIL_BITS_WORD
+#endif
+#endif
+
+/* ----------------------- Static functions ---------------------------------*/
+#ifdef MB_UTIL_HOST_LITTLE_ENDIAN
+static void     prvvMBUtilSwapCopy( UCHAR * pucDst, const UCHAR * pucSrc, USHORT usNRegs );
+#endif
+static void     prvvMBUtilMergeBits( UCHAR * pucDst, UCHAR ucDstShift, const UCHAR * pucSrc,
+                                     UCHAR ucSrcShift, UCHAR ucNBits );
+
 /* ----------------------- Start implementation -----------------------------*/
 void
 xMBUtilSetBits( UCHAR * ucByteBuf, USHORT usBitOffset, UCHAR ucNBits,
@@ -131,6 +166,12 @@ prveMBError2Exception( eMBErrorCode eErrorCode )
             eStatus = MB_EX_SLAVE_BUSY;
             break;
 
+#if MB_DEFER_ENABLED > 0
+        case MB_EPENDING:
+            eStatus = MB_EX_PENDING;
+            break;
+#endif
+
         default:
             eStatus = MB_EX_SLAVE_DEVICE_FAILURE;
             break;
@@ -138,3 +179,180 @@ prveMBError2Exception( eMBErrorCode eErrorCode )
 
     return eStatus;
 }
+
+void
+vMBUtilCopyBits( UCHAR * pucDst, USHORT usDstOffset, const UCHAR * pucSrc,
+                 USHORT usSrcOffset, USHORT usNBits )
+{
+    UCHAR           ucNBits;
+    UCHAR           ucShift;
+    USHORT          usNBytes;
+
+#ifdef MB_UTIL_BITS_WORD
+    unsigned int    uiWord;
+#endif
+
+    pucDst += usDstOffset / BITS_UCHAR;
+    pucSrc += usSrcOffset / BITS_UCHAR;
+    ucShift = ( UCHAR )( usSrcOffset % BITS_UCHAR );
+
+    /* Fill up the first destination byte if it is only partially covered. */
+    if( ( usNBits > 0 ) && ( ( usDstOffset % BITS_UCHAR ) != 0 ) )
+    {
+        ucNBits = ( UCHAR )( BITS_UCHAR - usDstOffset % BITS_UCHAR );
+        if( ucNBits > usNBits )
+        {
+            ucNBits = ( UCHAR )usNBits;
+        }
+        prvvMBUtilMergeBits( pucDst, ( UCHAR )( usDstOffset % BITS_UCHAR ), pucSrc, ucShift, ucNBits );
+        pucDst++;
+        pucSrc += ( ucShift + ucNBits ) / BITS_UCHAR;
+        ucShift = ( UCHAR )( ( ucShift + ucNBits ) % BITS_UCHAR );
+        usNBits -= ucNBits;
+    }
+
+    /* The destination is now byte aligned. */
+    usNBytes = ( USHORT )( usNBits / BITS_UCHAR );
+    if( ucShift == 0 )
+    {
+        memcpy( pucDst, pucSrc, usNBytes );
+        pucDst += usNBytes;
+        pucSrc += usNBytes;
+    }
+    else
+    {
+#ifdef MB_UTIL_BITS_WORD
+        /* Shift 32 bits at once. The low bits of the following source
+         * byte belong to the copied range, so reading it is safe. */
+        for( ; usNBytes >= 4; usNBytes -= 4 )
+        {
+            memcpy( &uiWord, pucSrc, 4 );
+            uiWord = ( uiWord >> ucShift ) | ( ( unsigned int )pucSrc[4] << ( 32 - ucShift ) );
+            memcpy( pucDst, &uiWord, 4 );
+            pucDst += 4;
+            pucSrc += 4;
+        }
+#endif
+        for( ; usNBytes > 0; usNBytes-- )
+        {
+            *pucDst++ = ( UCHAR )( ( pucSrc[0] >> ucShift ) | ( pucSrc[1] << ( BITS_UCHAR - ucShift ) ) );
+            pucSrc++;
+        }
+    }
+
+    /* Remaining bits of the last destination byte. */
+    if( ( usNBits % BITS_UCHAR ) != 0 )
+    {
+        prvvMBUtilMergeBits( pucDst, 0, pucSrc, ucShift, ( UCHAR )( usNBits % BITS_UCHAR ) );
+    }
+}
+
+static void
+prvvMBUtilMergeBits( UCHAR * pucDst, UCHAR ucDstShift, const UCHAR * pucSrc,
+                     UCHAR ucSrcShift, UCHAR ucNBits )
+{
+    USHORT          usValue;
+    UCHAR           ucMask;
+
+    /* Only touch the second source byte if the bits extend into it. */
+    usValue = pucSrc[0];
+    if( ( ucSrcShift + ucNBits ) > BITS_UCHAR )
+    {
+        usValue |= ( USHORT )( pucSrc[1] << BITS_UCHAR );
+    }
+    usValue >>= ucSrcShift;
+
+    ucMask = ( UCHAR )( ( ( 1U << ucNBits ) - 1U ) << ucDstShift );
+    *pucDst = ( UCHAR )( ( *pucDst & ~ucMask ) | ( ( usValue << ucDstShift ) & ucMask ) );
+}
+
+void
+vMBUtilCopyRegsToPDU( UCHAR * pucDst, const USHORT * pusSrc, USHORT usNRegs )
+{
+#if defined( MB_UTIL_HOST_BIG_ENDIAN )
+    memcpy( pucDst, pusSrc, ( size_t )usNRegs * 2 );
+#elif defined( MB_UTIL_HOST_LITTLE_ENDIAN )
+    prvvMBUtilSwapCopy( pucDst, ( const UCHAR * )pusSrc, usNRegs );
+#else
+    while( usNRegs-- > 0 )
+    {
+        *pucDst++ = ( UCHAR )( *pusSrc >> 8 );
+        *pucDst++ = ( UCHAR )( *pusSrc++ & 0xFF );
+    }
+#endif
+}
+
+void
+vMBUtilCopyRegsFromPDU( USHORT * pusDst, const UCHAR * pucSrc, USHORT usNRegs )
+{
+#if defined( MB_UTIL_HOST_BIG_ENDIAN )
+    memcpy( pusDst, pucSrc, ( size_t )usNRegs * 2 );
+#elif defined( MB_UTIL_HOST_LITTLE_ENDIAN )
+    prvvMBUtilSwapCopy( ( UCHAR * )pusDst, pucSrc, usNRegs );
+#else
+    while( usNRegs-- > 0 )
+    {
+        *pusDst++ = ( USHORT )( ( pucSrc[0] << 8 ) | pucSrc[1] );
+        pucSrc += 2;
+    }
+#endif
+}
+
+#ifdef MB_UTIL_HOST_LITTLE_ENDIAN
+static void
+prvvMBUtilSwapCopy( UCHAR * pucDst, const UCHAR * pucSrc, USHORT usNRegs )
+{
+#if defined( MB_UTIL_SWAP_AVX2 )
+    const __m256i   xMask = _mm256_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                              1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 );
+
+    for( ; usNRegs >= 16; usNRegs -= 16 )
+    {
+        _mm256_storeu_si256( ( __m256i * ) pucDst,
+                             _mm256_shuffle_epi8( _mm256_loadu_si256( ( const __m256i * )pucSrc ), xMask ) );
+        pucDst += 32;
+        pucSrc += 32;
+    }
+#endif
+#if defined( MB_UTIL_SWAP_SSE2 )
+    __m128i         xRegs;
+
+    /* SSE2 has no byte shuffle. Swap with two shifts instead. */
+    for( ; usNRegs >= 8; usNRegs -= 8 )
+    {
+        xRegs = _mm_loadu_si128( ( const __m128i * )pucSrc );
+        xRegs = _mm_or_si128( _mm_slli_epi16( xRegs, 8 ), _mm_srli_epi16( xRegs, 8 ) );
+        _mm_storeu_si128( ( __m128i * ) pucDst, xRegs );
+        pucDst += 16;
+        pucSrc += 16;
+    }
+#elif defined( MB_UTIL_SWAP_NEON )
+    for( ; usNRegs >= 8; usNRegs -= 8 )
+    {
+        vst1q_u8( pucDst, vrev16q_u8( vld1q_u8( pucSrc ) ) );
+        pucDst += 16;
+        pucSrc += 16;
+    }
+#elif defined( MB_UTIL_SWAP_WORD )
+    unsigned int    uiWord;
+
+    /* Swap two registers at once. memcpy( ) is used because the PDU is
+     * not aligned. */
+    for( ; usNRegs >= 2; usNRegs -= 2 )
+    {
+        memcpy( &uiWord, pucSrc, 4 );
+        uiWord = ( ( uiWord & 0x00FF00FFU ) << 8 ) | ( ( uiWord >> 8 ) & 0x00FF00FFU );
+        memcpy( pucDst, &uiWord, 4 );
+        pucDst += 4;
+        pucSrc += 4;
+    }
+#endif
+    for( ; usNRegs > 0; usNRegs-- )
+    {
+        pucDst[0] = pucSrc[1];
+        pucDst[1] = pucSrc[0];
+        pucDst += 2;
+        pucSrc += 2;
+    }
+}
+#endif
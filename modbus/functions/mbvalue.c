@@ -0,0 +1,303 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+#include "limits.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbvalue.h"
+
+#if MB_VALUE_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+/* The byte at offset i of a big endian value is stored at offset i ^ SWAP
+ * in the buffer. Bit 0 of the order swaps the bytes of each register and
+ * bit 1 reverses the order of the registers. */
+#define MB_VALUE_SWAP32( eOrder )   ( ( UCHAR )( eOrder ) )
+#define MB_VALUE_SWAP64( eOrder )   ( ( UCHAR )( ( ( eOrder ) & 1 ) | ( ( ( eOrder ) & 2 ) * 3 ) ) )
+
+/* Expand LOOP once for every order. The order passed to LOOP is a
+ * constant, so each loop is compiled without evaluating the order. */
+#define MB_VALUE_DISPATCH( eOrder, LOOP ) \
+    switch( eOrder )                      \
+    {                                     \
+    case MB_VALUE_BADC:                   \
+        LOOP( MB_VALUE_BADC );            \
+        break;                            \
+    case MB_VALUE_CDAB:                   \
+        LOOP( MB_VALUE_CDAB );            \
+        break;                            \
+    case MB_VALUE_DCBA:                   \
+        LOOP( MB_VALUE_DCBA );            \
+        break;                            \
+    default:                              \
+        LOOP( MB_VALUE_ABCD );            \
+        break;                            \
+    }
+
+/* ----------------------- Type definitions ---------------------------------*/
+#if UINT_MAX == 0xFFFFFFFFUL
+typedef unsigned int xMBValue32;
+#else
+typedef unsigned long xMBValue32;
+#endif
+
+/* ----------------------- Static functions ---------------------------------*/
+static xMBValue32 prvxMBValueLoad32( const UCHAR * pucBuf, UCHAR ucSwap );
+static void     prvvMBValueStore32( UCHAR * pucBuf, xMBValue32 xValue, UCHAR ucSwap );
+
+#if MB_VALUE_64_ENABLED > 0
+static unsigned long long prvullMBValueLoad64( const UCHAR * pucBuf, UCHAR ucSwap );
+static void     prvvMBValueStore64( UCHAR * pucBuf, unsigned long long ullValue, UCHAR ucSwap );
+#endif
+
+/* ----------------------- Start implementation -----------------------------*/
+ULONG
+ulMBValueGetU32( const UCHAR * pucBuf, eMBValueOrder eOrder )
+{
+    return ( ULONG )prvxMBValueLoad32( pucBuf, MB_VALUE_SWAP32( eOrder ) );
+}
+
+LONG
+lMBValueGetS32( const UCHAR * pucBuf, eMBValueOrder eOrder )
+{
+    ULONG           ulValue = ulMBValueGetU32( pucBuf, eOrder );
+
+    /* Sign extend if LONG is wider than 32 bits. */
+    return ( LONG )( ( ulValue ^ 0x80000000UL ) - 0x80000000UL );
+}
+
+float
+fMBValueGetFloat( const UCHAR * pucBuf, eMBValueOrder eOrder )
+{
+    xMBValue32      xValue = prvxMBValueLoad32( pucBuf, MB_VALUE_SWAP32( eOrder ) );
+    float           fValue;
+
+    assert( sizeof( float ) == sizeof( xMBValue32 ) );
+    memcpy( &fValue, &xValue, sizeof( fValue ) );
+    return fValue;
+}
+
+void
+vMBValueSetU32( UCHAR * pucBuf, ULONG ulValue, eMBValueOrder eOrder )
+{
+    prvvMBValueStore32( pucBuf, ( xMBValue32 )( ulValue & 0xFFFFFFFFUL ), MB_VALUE_SWAP32( eOrder ) );
+}
+
+void
+vMBValueSetFloat( UCHAR * pucBuf, float fValue, eMBValueOrder eOrder )
+{
+    xMBValue32      xValue;
+
+    assert( sizeof( float ) == sizeof( xMBValue32 ) );
+    memcpy( &xValue, &fValue, sizeof( xValue ) );
+    prvvMBValueStore32( pucBuf, xValue, MB_VALUE_SWAP32( eOrder ) );
+}
+
+void
+vMBValueDecodeU32( ULONG * pulDst, const UCHAR * pucSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+
+#define MB_VALUE_DECODE_U32( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        pulDst[usIdx] = ( ULONG )prvxMBValueLoad32( &pucSrc[usIdx * 4], MB_VALUE_SWAP32( eConstOrder ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_DECODE_U32 );
+#undef MB_VALUE_DECODE_U32
+}
+
+void
+vMBValueEncodeU32( UCHAR * pucDst, const ULONG * pulSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+
+#define MB_VALUE_ENCODE_U32( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        prvvMBValueStore32( &pucDst[usIdx * 4], ( xMBValue32 )( pulSrc[usIdx] & 0xFFFFFFFFUL ), \
+                            MB_VALUE_SWAP32( eConstOrder ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_ENCODE_U32 );
+#undef MB_VALUE_ENCODE_U32
+}
+
+void
+vMBValueDecodeFloat( float *pfDst, const UCHAR * pucSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+    xMBValue32      xValue;
+
+    assert( sizeof( float ) == sizeof( xMBValue32 ) );
+
+#define MB_VALUE_DECODE_FLOAT( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        xValue = prvxMBValueLoad32( &pucSrc[usIdx * 4], MB_VALUE_SWAP32( eConstOrder ) ); \
+        memcpy( &pfDst[usIdx], &xValue, sizeof( float ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_DECODE_FLOAT );
+#undef MB_VALUE_DECODE_FLOAT
+}
+
+void
+vMBValueEncodeFloat( UCHAR * pucDst, const float *pfSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+    xMBValue32      xValue;
+
+    assert( sizeof( float ) == sizeof( xMBValue32 ) );
+
+#define MB_VALUE_ENCODE_FLOAT( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        memcpy( &xValue, &pfSrc[usIdx], sizeof( float ) ); \
+        prvvMBValueStore32( &pucDst[usIdx * 4], xValue, MB_VALUE_SWAP32( eConstOrder ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_ENCODE_FLOAT );
+#undef MB_VALUE_ENCODE_FLOAT
+}
+
+#if MB_VALUE_64_ENABLED > 0
+unsigned long long
+ullMBValueGetU64( const UCHAR * pucBuf, eMBValueOrder eOrder )
+{
+    return prvullMBValueLoad64( pucBuf, MB_VALUE_SWAP64( eOrder ) );
+}
+
+double
+dMBValueGetDouble( const UCHAR * pucBuf, eMBValueOrder eOrder )
+{
+    unsigned long long ullValue = prvullMBValueLoad64( pucBuf, MB_VALUE_SWAP64( eOrder ) );
+    double          dValue;
+
+    assert( sizeof( double ) == sizeof( ullValue ) );
+    memcpy( &dValue, &ullValue, sizeof( dValue ) );
+    return dValue;
+}
+
+void
+vMBValueSetU64( UCHAR * pucBuf, unsigned long long ullValue, eMBValueOrder eOrder )
+{
+    prvvMBValueStore64( pucBuf, ullValue, MB_VALUE_SWAP64( eOrder ) );
+}
+
+void
+vMBValueSetDouble( UCHAR * pucBuf, double dValue, eMBValueOrder eOrder )
+{
+    unsigned long long ullValue;
+
+    assert( sizeof( double ) == sizeof( ullValue ) );
+    memcpy( &ullValue, &dValue, sizeof( ullValue ) );
+    prvvMBValueStore64( pucBuf, ullValue, MB_VALUE_SWAP64( eOrder ) );
+}
+
+void
+vMBValueDecodeDouble( double *pdDst, const UCHAR * pucSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+    unsigned long long ullValue;
+
+    assert( sizeof( double ) == sizeof( ullValue ) );
+
+#define MB_VALUE_DECODE_DOUBLE( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        ullValue = prvullMBValueLoad64( &pucSrc[usIdx * 8], MB_VALUE_SWAP64( eConstOrder ) ); \
+        memcpy( &pdDst[usIdx], &ullValue, sizeof( double ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_DECODE_DOUBLE );
+#undef MB_VALUE_DECODE_DOUBLE
+}
+
+void
+vMBValueEncodeDouble( UCHAR * pucDst, const double *pdSrc, USHORT usNValues, eMBValueOrder eOrder )
+{
+    USHORT          usIdx;
+    unsigned long long ullValue;
+
+    assert( sizeof( double ) == sizeof( ullValue ) );
+
+#define MB_VALUE_ENCODE_DOUBLE( eConstOrder ) \
+    for( usIdx = 0; usIdx < usNValues; usIdx++ ) \
+    { \
+        memcpy( &ullValue, &pdSrc[usIdx], sizeof( double ) ); \
+        prvvMBValueStore64( &pucDst[usIdx * 8], ullValue, MB_VALUE_SWAP64( eConstOrder ) ); \
+    }
+
+    MB_VALUE_DISPATCH( eOrder, MB_VALUE_ENCODE_DOUBLE );
+#undef MB_VALUE_ENCODE_DOUBLE
+}
+
+static unsigned long long
+prvullMBValueLoad64( const UCHAR * pucBuf, UCHAR ucSwap )
+{
+    return ( ( unsigned long long )prvxMBValueLoad32( &pucBuf[0 ^ ( ucSwap & 4 )], ( UCHAR )( ucSwap & 3 ) ) << 32 ) |
+        prvxMBValueLoad32( &pucBuf[4 ^ ( ucSwap & 4 )], ( UCHAR )( ucSwap & 3 ) );
+}
+
+static void
+prvvMBValueStore64( UCHAR * pucBuf, unsigned long long ullValue, UCHAR ucSwap )
+{
+    prvvMBValueStore32( &pucBuf[0 ^ ( ucSwap & 4 )], ( xMBValue32 )( ullValue >> 32 ), ( UCHAR )( ucSwap & 3 ) );
+    prvvMBValueStore32( &pucBuf[4 ^ ( ucSwap & 4 )], ( xMBValue32 )( ullValue & 0xFFFFFFFFUL ),
+                        ( UCHAR )( ucSwap & 3 ) );
+}
+#endif
+
+static          xMBValue32
+prvxMBValueLoad32( const UCHAR * pucBuf, UCHAR ucSwap )
+{
+    return ( ( xMBValue32 ) pucBuf[0 ^ ucSwap] << 24 ) | ( ( xMBValue32 ) pucBuf[1 ^ ucSwap] << 16 ) |
+        ( ( xMBValue32 ) pucBuf[2 ^ ucSwap] << 8 ) | ( xMBValue32 ) pucBuf[3 ^ ucSwap];
+}
+
+static void
+prvvMBValueStore32( UCHAR * pucBuf, xMBValue32 xValue, UCHAR ucSwap )
+{
+    pucBuf[0 ^ ucSwap] = ( UCHAR )( xValue >> 24 );
+    pucBuf[1 ^ ucSwap] = ( UCHAR )( xValue >> 16 );
+    pucBuf[2 ^ ucSwap] = ( UCHAR )( xValue >> 8 );
+    pucBuf[3 ^ ucSwap] = ( UCHAR )( xValue );
+}
+
+#endif
@@ -117,7 +117,8 @@ typedef enum
     MB_ENORES,                  /*!< insufficient resources. */
     MB_EIO,                     /*!< I/O error. */
     MB_EILLSTATE,               /*!< protocol stack in illegal state. */
-    MB_ETIMEDOUT                /*!< timeout error occurred. */
+    MB_ETIMEDOUT,               /*!< timeout error occurred. */
+    MB_EPENDING                 /*!< request is completed later. */
 } eMBErrorCode;
 
 
@@ -243,6 +244,39 @@ eMBErrorCode    eMBSetSlaveID( UCHAR ucSlaveID, BOOL xIsRunning,
                                UCHAR const *pucAdditional,
                                USHORT usAdditionalLen );
 
+/*! \ingroup modbus
+ * \brief Configure the objects returned by <em>Read Device Identification</em>.
+ *
+ * This function should be called when the Modbus function <em>Read Device
+ * Identification</em> is enabled ( By defining MB_FUNC_OTHER_DEVICE_ID_ENABLED
+ * in mbconfig.h ). The table already uses the encoding of the response, i.e.
+ * each object consists of its object id, its length and its value. The
+ * objects must be sorted by their object id. The objects 0x00 - 0x02 (
+ * <em>VendorName</em>, <em>ProductCode</em> and <em>MajorMinorRevision</em>)
+ * are mandatory. The table is not copied and can therefore be placed in
+ * read only memory.
+ *
+ * \code
+ * static const UCHAR ucDeviceID[] = {
+ *     0x00, 4, 'A', 'C', 'M', 'E',
+ *     0x01, 3, 'P', 'L', 'C',
+ *     0x02, 4, 'V', '1', '.', '0'
+ * };
+ * eMBSetDeviceID( ucDeviceID, sizeof( ucDeviceID ) );
+ * \endcode
+ *
+ * \param pucObjects The object table. Must stay valid while the protocol
+ *   stack is running.
+ * \param usLen Length of the object table in bytes.
+ *
+ * \return If the table is malformed, an object does not fit into a single
+ *   response or the mandatory objects are missing eMBErrorCode::MB_EINVAL is
+ *   returned. If the table has more than MB_FUNC_OTHER_DEVICE_ID_OBJECTS_MAX
+ *   objects eMBErrorCode::MB_ENORES is returned. Otherwise it returns
+ *   eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBSetDeviceID( UCHAR const *pucObjects, USHORT usLen );
+
 /*! \ingroup modbus
  * \brief Registers a callback handler for a given function code.
  *
@@ -309,6 +343,8 @@ eMBErrorCode    eMBRegisterCB( UCHAR ucFunctionCode,
  *       exception is sent as a response.
  *   - eMBErrorCode::MB_EIO If an unrecoverable error occurred. In this case
  *       a <b>SLAVE DEVICE FAILURE</b> exception is sent as a response.
+ *   - eMBErrorCode::MB_EPENDING If the request has been deferred with
+ *       eMBDeferRequest( ). The response is sent by eMBCompleteRequest( ).
  */
 eMBErrorCode    eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress,
                                USHORT usNRegs );
@@ -344,10 +380,34 @@ eMBErrorCode    eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress,
  *       exception is sent as a response.
  *   - eMBErrorCode::MB_EIO If an unrecoverable error occurred. In this case
  *       a <b>SLAVE DEVICE FAILURE</b> exception is sent as a response.
+ *   - eMBErrorCode::MB_EPENDING If the request has been deferred with
+ *       eMBDeferRequest( ). The response is sent by eMBCompleteRequest( ).
  */
 eMBErrorCode    eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
                                  USHORT usNRegs, eMBRegisterMode eMode );
 
+/*! \ingroup modbus_registers
+ * \brief Callback function used if a <em>Holding Register</em> is modified
+ *   by the <em>Mask Write Register</em> function.
+ *
+ * This function is only used if MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED is set
+ * in mbconfig.h. It allows the application to apply the masks atomically,
+ * e.g. with a single instruction. Without it the stack reads and writes the
+ * register with two calls of eMBRegHoldingCB(  ) which is not atomic with
+ * respect to other tasks or interrupt handlers. The new register value is
+ * given by
+ * <tt>( usCurrent & usAndMask ) | ( usOrMask & ~usAndMask )</tt>.
+ *
+ * \param usAddress The address of the register.
+ * \param usAndMask The AND mask.
+ * \param usOrMask The OR mask.
+ *
+ * \return The function must return one of the error codes documented for
+ *   eMBRegHoldingCB(  ).
+ */
+eMBErrorCode    eMBRegHoldingMaskCB( USHORT usAddress, USHORT usAndMask,
+                                     USHORT usOrMask );
+
 /*! \ingroup modbus_registers
  * \brief Callback function used if a <em>Coil Register</em> value is
  *   read or written by the protocol stack. If you are going to use
@@ -379,6 +439,8 @@ eMBErrorCode    eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
  *       exception is sent as a response.
  *   - eMBErrorCode::MB_EIO If an unrecoverable error occurred. In this case
  *       a <b>SLAVE DEVICE FAILURE</b> exception is sent as a response.
+ *   - eMBErrorCode::MB_EPENDING If the request has been deferred with
+ *       eMBDeferRequest( ). The response is sent by eMBCompleteRequest( ).
  */
 eMBErrorCode    eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
                                USHORT usNCoils, eMBRegisterMode eMode );
@@ -408,6 +470,8 @@ eMBErrorCode    eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
  *       exception is sent as a response.
  *   - eMBErrorCode::MB_EIO If an unrecoverable error occurred. In this case
  *       a <b>SLAVE DEVICE FAILURE</b> exception is sent as a response.
+ *   - eMBErrorCode::MB_EPENDING If the request has been deferred with
+ *       eMBDeferRequest( ). The response is sent by eMBCompleteRequest( ).
  */
 eMBErrorCode    eMBRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress,
                                   USHORT usNDiscrete );
@@ -449,6 +513,39 @@ eMBErrorCode    eMBRegFileCB( UCHAR * pucFileBuffer, USHORT usFileNumber,
                               USHORT usRecordNumber, USHORT usRecordLength,
 							  eMBRegisterMode eMode );
 
+/*! \ingroup modbus_registers
+ * \brief A single sub-request of a <em>Read/Write File Record</em> request.
+ */
+typedef struct
+{
+    UCHAR          *pucFileBuffer;  /*!< Record data in the PDU. */
+    USHORT          usFileNumber;   /*!< The index of the file. */
+    USHORT          usRecordNumber; /*!< First record within the file. */
+    USHORT          usRecordLength; /*!< Number of records. */
+} xMBFileRequest;
+
+/*! \ingroup modbus_registers
+ * \brief Callback function used for all sub-requests of a <em>Read/Write
+ *   File Record</em> request at once.
+ *
+ * This function is only used if MB_FUNC_FILE_VEC_CB_ENABLED is set in
+ * mbconfig.h. Otherwise eMBRegFileCB(  ) is called for each sub-request.
+ * Having all sub-requests available allows the application to combine
+ * accesses to the underlying storage. The buffers of the sub-requests use
+ * the same encoding as for eMBRegFileCB(  ) and do not overlap.
+ *
+ * \param pxRequests The sub-requests in the order of the PDU.
+ * \param usNRequests Number of sub-requests.
+ * \param eMode If eMBRegisterMode::MB_REG_WRITE the application values should
+ *   be updated from the buffers. If eMBRegisterMode::MB_REG_READ the
+ *   application should store the current values in the buffers.
+ *
+ * \return The function must return one of the error codes documented for
+ *   eMBRegFileCB(  ). An error applies to the whole request.
+ */
+eMBErrorCode    eMBRegFileVecCB( xMBFileRequest * pxRequests, USHORT usNRequests,
+                                 eMBRegisterMode eMode );
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
@@ -0,0 +1,99 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_ATOMIC_H
+#define _MB_ATOMIC_H
+
+/* ----------------------- Defines ------------------------------------------*/
+/* Primitives for variables shared between the task calling eMBPoll( ) and
+ * an application thread or interrupt handler. Each variable must only be
+ * written by one side. The store with release semantics makes all previous
+ * writes visible before the new value, the load with acquire semantics
+ * makes sure that no later read is done before the value was read.
+ *
+ * If the compiler provides the GCC __atomic builtins they are used.
+ * Otherwise the shared variables must be declared volatile and the port
+ * can supply a memory barrier by defining MB_PORT_MEMORY_BARRIER( ) in
+ * port.h. This is not required on single core targets without a data
+ * cache, which are the majority of the supported ports.
+ *
+ * The fences order plain accesses around them. MB_ATOMIC_CAS( ) stores
+ * xDesired if the variable equals xExpected and sets xResult to TRUE on
+ * success. xExpected must be a variable and may be overwritten on failure.
+ * MB_ATOMIC_LOCK( ) and MB_ATOMIC_UNLOCK( ) protect short sections against
+ * other writers. Without the builtins these primitives fall back to the
+ * critical section of the port.
+ */
+#if defined( __GNUC__ ) && defined( __ATOMIC_ACQUIRE )
+
+#define MB_ATOMIC_LOAD_ACQUIRE( pxVar, xResult ) \
+    ( xResult ) = __atomic_load_n( ( pxVar ), __ATOMIC_ACQUIRE )
+#define MB_ATOMIC_STORE_RELEASE( pxVar, xValue ) \
+    __atomic_store_n( ( pxVar ), ( xValue ), __ATOMIC_RELEASE )
+#define MB_ATOMIC_FENCE_ACQUIRE( ) \
+    __atomic_thread_fence( __ATOMIC_ACQUIRE )
+#define MB_ATOMIC_FENCE_RELEASE( ) \
+    __atomic_thread_fence( __ATOMIC_RELEASE )
+#define MB_ATOMIC_CAS( pxVar, xExpected, xDesired, xResult ) \
+    ( xResult ) = __atomic_compare_exchange_n( ( pxVar ), &( xExpected ), ( xDesired ), 0, \
+                                               __ATOMIC_ACQ_REL, __ATOMIC_RELAXED )
+#define MB_ATOMIC_FETCH_ADD( pxVar, xValue ) \
+    ( void )__atomic_fetch_add( ( pxVar ), ( xValue ), __ATOMIC_ACQ_REL )
+#define MB_ATOMIC_LOCK( pxLock ) \
+    do { } while( __atomic_exchange_n( ( pxLock ), 1, __ATOMIC_ACQUIRE ) != 0 )
+#define MB_ATOMIC_UNLOCK( pxLock ) \
+    __atomic_store_n( ( pxLock ), 0, __ATOMIC_RELEASE )
+
+#else
+
+#ifndef MB_PORT_MEMORY_BARRIER
+#define MB_PORT_MEMORY_BARRIER( )
+#endif
+
+#define MB_ATOMIC_LOAD_ACQUIRE( pxVar, xResult ) \
+    do { ( xResult ) = *( pxVar ); MB_PORT_MEMORY_BARRIER(  ); } while( 0 )
+#define MB_ATOMIC_STORE_RELEASE( pxVar, xValue ) \
+    do { MB_PORT_MEMORY_BARRIER(  ); *( pxVar ) = ( xValue ); } while( 0 )
+#define MB_ATOMIC_FENCE_ACQUIRE( ) \
+    MB_PORT_MEMORY_BARRIER(  )
+#define MB_ATOMIC_FENCE_RELEASE( ) \
+    MB_PORT_MEMORY_BARRIER(  )
+#define MB_ATOMIC_CAS( pxVar, xExpected, xDesired, xResult ) \
+    do { ENTER_CRITICAL_SECTION(  ); ( xResult ) = ( *( pxVar ) == ( xExpected ) ); \
+         if( xResult ) { *( pxVar ) = ( xDesired ); } EXIT_CRITICAL_SECTION(  ); } while( 0 )
+#define MB_ATOMIC_FETCH_ADD( pxVar, xValue ) \
+    do { ENTER_CRITICAL_SECTION(  ); *( pxVar ) += ( xValue ); EXIT_CRITICAL_SECTION(  ); } while( 0 )
+#define MB_ATOMIC_LOCK( pxLock ) \
+    do { ENTER_CRITICAL_SECTION(  ); ( void )( pxLock ); } while( 0 )
+#define MB_ATOMIC_UNLOCK( pxLock ) \
+    do { ( void )( pxLock ); EXIT_CRITICAL_SECTION(  ); } while( 0 )
+
+#endif
+
+#endif
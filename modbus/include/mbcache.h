@@ -0,0 +1,95 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_CACHE_H
+#define _MB_CACHE_H
+
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbregmap.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_cache Response Cache
+ * \code #include "mbcache.h" \endcode
+ *
+ * If MB_CACHE_ENABLED is set to <code>1</code> the responses to the read
+ * functions 0x01 to 0x04 can be cached. This is useful if several masters
+ * read the same values and the callbacks are slow. A response is cached if
+ * the request lies within a range configured with eMBCacheSetTTL( ). It is
+ * stored as an encoded PDU together with the unit, the function code, the
+ * address and the count of the request. An identical request within the
+ * time to live of the range is answered by copying the stored PDU. The
+ * callbacks are not called.
+ *
+ * Writes by the master remove all overlapping responses. If the
+ * application changes values it should call vMBCacheInvalidate( ) or
+ * choose a time to live which can be tolerated.
+ *
+ * The timestamps are taken from ulMBPortGetTimestampUs( ), which must be
+ * provided by the port.
+ *
+ * \code
+ * // Input registers 1 - 100 can be up to 5ms old.
+ * eMBCacheSetTTL( MB_REG_MAP_INPUT, 1, 100, 5000 );
+ * \endcode
+ */
+/*! \addtogroup modbus_cache
+ *  @{
+ */
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Enable caching for a range.
+ *
+ * \param eTable The table.
+ * \param usAddress First address as passed to the callbacks.
+ * \param usNRegs Number of registers or bits.
+ * \param ulTTLUs How long a response is valid in microseconds.
+ *
+ * \return eMBErrorCode::MB_ENORES if MB_CACHE_RANGES_MAX ranges are set.
+ *   eMBErrorCode::MB_EINVAL if an argument is invalid. Otherwise
+ *   eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBCacheSetTTL( eMBRegMapTable eTable, USHORT usAddress,
+                                USHORT usNRegs, ULONG ulTTLUs );
+
+/*! \brief Remove the cached responses which overlap a range. */
+void            vMBCacheInvalidate( eMBRegMapTable eTable, USHORT usAddress,
+                                    USHORT usNRegs );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+BOOL            xMBCacheLookup( UCHAR ucUnit, UCHAR * pucFrame, USHORT * pusLength );
+void            vMBCacheStore( const UCHAR * pucFrame, USHORT usLength );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -98,10 +98,12 @@ PR_BEGIN_EXTERN_C
  *
  * The maximum number of supported Modbus functions must be greater than
  * the sum of all enabled functions in this file and custom function
- * handlers. If set to small adding more functions will fail.
+ * handlers. If set to small adding more functions will fail. The build
+ * fails if the enabled functions do not fit. The default has room for
+ * all of them and some custom handlers.
  */
 #ifndef MB_FUNC_HANDLERS_MAX
-#define MB_FUNC_HANDLERS_MAX                    ( 16 )
+#define MB_FUNC_HANDLERS_MAX                    ( 24 )
 #endif
 
 /*! \brief Number of bytes which should be allocated for the <em>Report Slave ID
@@ -121,6 +123,24 @@ PR_BEGIN_EXTERN_C
 #define MB_FUNC_OTHER_REP_SLAVEID_ENABLED       ( 1 )
 #endif
 
+/*! \brief If the <em>Read Device Identification</em> function should be enabled.
+ *
+ * The objects are set with eMBSetDeviceID(  ).
+ */
+#ifndef MB_FUNC_OTHER_DEVICE_ID_ENABLED
+#define MB_FUNC_OTHER_DEVICE_ID_ENABLED         (  0 )
+#endif
+
+/*! \brief Maximum number of objects for the <em>Read Device
+ *    Identification</em> function.
+ *
+ * An offset table of this size is built by eMBSetDeviceID(  ) so that
+ * responses can be created without parsing the object table.
+ */
+#ifndef MB_FUNC_OTHER_DEVICE_ID_OBJECTS_MAX
+#define MB_FUNC_OTHER_DEVICE_ID_OBJECTS_MAX     ( 16 )
+#endif
+
 /*! \brief If the <em>Read Input Registers</em> function should be enabled. */
 #ifndef MB_FUNC_READ_INPUT_ENABLED
 #define MB_FUNC_READ_INPUT_ENABLED              ( 1 )
@@ -141,6 +161,36 @@ PR_BEGIN_EXTERN_C
 #define MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED  ( 1 )
 #endif
 
+/*! \brief If the <em>Mask Write Register</em> function should be enabled. */
+#ifndef MB_FUNC_MASK_WRITE_HOLDING_ENABLED
+#define MB_FUNC_MASK_WRITE_HOLDING_ENABLED      (  0 )
+#endif
+
+/*! \brief If the <em>Mask Write Register</em> function should use the
+ *    callback eMBRegHoldingMaskCB(  ).
+ *
+ * If not enabled the register is read and written with two calls of
+ * eMBRegHoldingCB(  ). This read-modify-write cycle is not atomic. Enable
+ * this option if the register is also modified by other tasks or interrupt
+ * handlers.
+ */
+#ifndef MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED
+#define MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED   (  0 )
+#endif
+
+/*! \brief If the <em>Read FIFO Queue</em> function should be enabled.
+ *
+ * The queues are registered with eMBFifoRegister(  ).
+ */
+#ifndef MB_FUNC_READ_FIFO_ENABLED
+#define MB_FUNC_READ_FIFO_ENABLED               (  0 )
+#endif
+
+/*! \brief Maximum number of FIFO queues which can be registered. */
+#ifndef MB_FUNC_READ_FIFO_MAX
+#define MB_FUNC_READ_FIFO_MAX                   (  4 )
+#endif
+
 /*! \brief If the <em>Read Coils</em> function should be enabled. */
 #ifndef MB_FUNC_READ_COILS_ENABLED
 #define MB_FUNC_READ_COILS_ENABLED              ( 1 )
@@ -176,6 +226,253 @@ PR_BEGIN_EXTERN_C
 #define MB_FUNC_READ_FILE_ENABLED               (  0 )
 #endif
 
+/*! \brief Maximum number of sub-requests in a <em>Read/Write File
+ *    Record</em> request.
+ *
+ * The sub-requests are parsed into an array on the stack. The protocol
+ * allows up to 35 sub-requests for reading and 27 for writing. Requests
+ * with more sub-requests are answered with an <b>ILLEGAL DATA VALUE</b>
+ * exception.
+ */
+#ifndef MB_FUNC_FILE_REQUESTS_MAX
+#define MB_FUNC_FILE_REQUESTS_MAX               (  8 )
+#endif
+
+/*! \brief If the file record functions should use the callback
+ *    eMBRegFileVecCB(  ).
+ *
+ * If not enabled eMBRegFileCB(  ) is called once for each sub-request.
+ */
+#ifndef MB_FUNC_FILE_VEC_CB_ENABLED
+#define MB_FUNC_FILE_VEC_CB_ENABLED             (  0 )
+#endif
+
+/*! \brief If the file record functions should be served from memory
+ *    regions registered with eMBFileMapRegister(  ).
+ *
+ * If enabled the callbacks eMBRegFileCB(  ) and eMBRegFileVecCB(  ) are
+ * not used.
+ */
+#ifndef MB_FUNC_FILE_MAP_ENABLED
+#define MB_FUNC_FILE_MAP_ENABLED                (  0 )
+#endif
+
+/*! \brief Maximum number of memory regions for the file record functions. */
+#ifndef MB_FUNC_FILE_MAP_MAX
+#define MB_FUNC_FILE_MAP_MAX                    (  4 )
+#endif
+
+/*! \brief If the <em>Diagnostics</em> function should be enabled.
+ *
+ * The sub-functions <em>Return Query Data</em>, <em>Restart Communications
+ * Option</em>, the serial line counters 0x0B - 0x12 and the functions for
+ * clearing them are supported.
+ */
+#ifndef MB_FUNC_DIAG_DIAGNOSTIC_ENABLED
+#define MB_FUNC_DIAG_DIAGNOSTIC_ENABLED         (  0 )
+#endif
+
+/*! \brief If the <em>Get Comm Event Counter</em> and <em>Get Comm Event
+ * Log</em> functions should be enabled.
+ *
+ * The message count in the event log is taken from the serial line
+ * counters which are shared with the <em>Diagnostics</em> function.
+ */
+#ifndef MB_FUNC_DIAG_COM_EVENT_ENABLED
+#define MB_FUNC_DIAG_COM_EVENT_ENABLED          (  0 )
+#endif
+
+/*! \brief Number of events stored in the communication event log.
+ *
+ * The specification allows at most 64 events.
+ */
+#ifndef MB_FUNC_DIAG_COM_EVENT_LOG_SIZE
+#define MB_FUNC_DIAG_COM_EVENT_LOG_SIZE         ( 64 )
+#endif
+
+/*! \brief If vMBUtilCopyRegsToPDU(  ) and vMBUtilCopyRegsFromPDU(  ) may use
+ *    vector instructions.
+ *
+ * The instructions are only used if the compiler targets them, i.e. if
+ * __SSE2__, __AVX2__ or __ARM_NEON is defined.
+ */
+#ifndef MB_UTIL_COPY_REGS_SIMD_ENABLED
+#define MB_UTIL_COPY_REGS_SIMD_ENABLED          (  1 )
+#endif
+
+/*! \brief If register images should be enabled.
+ *
+ * See mbregimage.h for details.
+ */
+#ifndef MB_REG_IMAGE_ENABLED
+#define MB_REG_IMAGE_ENABLED                    (  0 )
+#endif
+
+/*! \brief How often a reader tries to take a snapshot of a register image.
+ *
+ * If a writer is active during all attempts the request is answered with
+ * the exception <em>Slave Device Busy</em>.
+ */
+#ifndef MB_REG_IMAGE_READ_RETRIES
+#define MB_REG_IMAGE_READ_RETRIES               ( 1000 )
+#endif
+
+/*! \brief If writes by the master should be recorded in a journal.
+ *
+ * See mbjournal.h for details.
+ */
+#ifndef MB_JOURNAL_ENABLED
+#define MB_JOURNAL_ENABLED                      (  0 )
+#endif
+
+/*! \brief Number of records in the write journal. Must be a power of two. */
+#ifndef MB_JOURNAL_SIZE
+#define MB_JOURNAL_SIZE                         ( 64 )
+#endif
+
+/*! \brief If the application can subscribe to changes of registers.
+ *
+ * See mbsubscribe.h for details.
+ */
+#ifndef MB_SUBSCRIBE_ENABLED
+#define MB_SUBSCRIBE_ENABLED                    (  0 )
+#endif
+
+/*! \brief Maximum number of subscriptions. */
+#ifndef MB_SUBSCRIBE_MAX
+#define MB_SUBSCRIBE_MAX                        (  8 )
+#endif
+
+/*! \brief Maximum number of registers of a subscription. */
+#ifndef MB_SUBSCRIBE_REGS_MAX
+#define MB_SUBSCRIBE_REGS_MAX                   ( 125 )
+#endif
+
+/*! \brief If responses to read requests can be cached.
+ *
+ * See mbcache.h for details. Requires ulMBPortGetTimestampUs( ).
+ */
+#ifndef MB_CACHE_ENABLED
+#define MB_CACHE_ENABLED                        (  0 )
+#endif
+
+/*! \brief Number of cached responses. */
+#ifndef MB_CACHE_ENTRIES
+#define MB_CACHE_ENTRIES                        (  4 )
+#endif
+
+/*! \brief Maximum size of a cached response PDU.
+ *
+ * Larger responses are not cached. The default holds every response.
+ */
+#ifndef MB_CACHE_PDU_MAX
+#define MB_CACHE_PDU_MAX                        ( 253 )
+#endif
+
+/*! \brief Number of ranges for which caching can be enabled. */
+#ifndef MB_CACHE_RANGES_MAX
+#define MB_CACHE_RANGES_MAX                     (  4 )
+#endif
+
+/*! \brief If register callbacks can defer requests.
+ *
+ * See mbdefer.h for details. Requires ulMBPortGetTimestampUs( ).
+ */
+#ifndef MB_DEFER_ENABLED
+#define MB_DEFER_ENABLED                        (  0 )
+#endif
+
+/*! \brief Number of requests which can be deferred at the same time. */
+#ifndef MB_DEFER_SLOTS
+#define MB_DEFER_SLOTS                          (  4 )
+#endif
+
+/*! \brief Time in microseconds after which a deferred request fails. */
+#ifndef MB_DEFER_TIMEOUT_US
+#define MB_DEFER_TIMEOUT_US                     ( 1000000UL )
+#endif
+
+/*! \brief Exception sent if a deferred request times out.
+ *
+ * Either <b>SLAVE DEVICE BUSY</b> (0x06) or <b>ACKNOWLEDGE</b> (0x05).
+ */
+#ifndef MB_DEFER_TIMEOUT_EXCEPTION
+#define MB_DEFER_TIMEOUT_EXCEPTION              ( 0x06 )
+#endif
+
+/*! \brief If the function handlers are called by worker threads.
+ *
+ * See mbexec.h for details. Requires xMBPortExecSubmit( ). Can not be
+ * combined with MB_DEFER_ENABLED, MB_CACHE_ENABLED or MB_SUBSCRIBE_ENABLED.
+ */
+#ifndef MB_EXEC_ENABLED
+#define MB_EXEC_ENABLED                         (  0 )
+#endif
+
+/*! \brief Number of requests which can be executed or wait for their
+ * response at the same time. */
+#ifndef MB_EXEC_JOBS
+#define MB_EXEC_JOBS                            (  8 )
+#endif
+
+/*! \brief Number of coroutines of mbcoro.hpp which can run at a time. */
+#ifndef MB_CO_FRAMES
+#define MB_CO_FRAMES                            (  4 )
+#endif
+
+/*! \brief Maximum size of a coroutine frame in mbcoro.hpp. */
+#ifndef MB_CO_FRAME_SIZE
+#define MB_CO_FRAME_SIZE                        ( 256 )
+#endif
+
+/*! \brief If the functions for 32 and 64 bit values should be enabled.
+ *
+ * See mbvalue.h for details.
+ */
+#ifndef MB_VALUE_ENABLED
+#define MB_VALUE_ENABLED                        (  0 )
+#endif
+
+/*! \brief If the functions for 64 bit values should be enabled.
+ *
+ * They require a compiler which supports <code>unsigned long long</code>.
+ */
+#ifndef MB_VALUE_64_ENABLED
+#define MB_VALUE_64_ENABLED                     (  1 )
+#endif
+
+/*! \brief If register ranges can be mapped directly to variables.
+ *
+ * See eMBRegMapSet(  ) for details. If no map is set for a table the
+ * callbacks are used as before.
+ */
+#ifndef MB_REG_MAP_ENABLED
+#define MB_REG_MAP_ENABLED                      (  0 )
+#endif
+
+/*! \brief If the protocol stack should collect statistics.
+ *
+ * See eMBGetStats( ) for details. The statistics require about
+ * 1.6kB of RAM on a 32 bit target.
+ */
+#ifndef MB_STATS_ENABLED
+#define MB_STATS_ENABLED                        (  0 )
+#endif
+
+/*! \brief If a histogram of the response latency should be collected.
+ *
+ * Requires MB_STATS_ENABLED and a porting layer which implements the
+ * function ulMBPortGetTimestampUs( ).
+ */
+#ifndef MB_STATS_LATENCY_ENABLED
+#define MB_STATS_LATENCY_ENABLED                (  0 )
+#endif
+
+/*! \brief Number of logarithmic buckets in the latency histogram. */
+#ifndef MB_STATS_LATENCY_BUCKETS
+#define MB_STATS_LATENCY_BUCKETS                ( 20 )
+#endif
+
 /*! @} */
 #ifdef __cplusplus
     PR_END_EXTERN_C
@@ -0,0 +1,592 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_CORO_HPP
+#define _MB_CORO_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+
+#include "port.h"
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbport.h"
+#include "mbdefer.h"
+
+#if MB_DEFER_ENABLED == 0
+#error "mbcoro.hpp requires MB_DEFER_ENABLED"
+#endif
+
+/*! \defgroup modbus_coro C++ Coroutines
+ * \code #include "mbcoro.hpp" \endcode
+ *
+ * This header only C++20 layer allows register callbacks and function
+ * handlers to be written as coroutines. They return MB::MBCoTask and can
+ * wait for an MB::MBCoSignal, which is set by an interrupt handler or
+ * another thread, or for an MB::MBCoDelay. The waiting coroutines are
+ * resumed by MB::eMBCoPoll( ), which replaces eMBPoll( ) in the main loop.
+ *
+ * The adapters MB::eMBCoRegInputCB( ), MB::eMBCoRegHoldingCB( ),
+ * MB::eMBCoRegCoilsCB( ), MB::eMBCoRegDiscreteCB( ) and
+ * MB::eMBCoFuncHandler( ) start a coroutine with a buffer from a pool. If
+ * it finishes without waiting the result is copied to the frame of the
+ * stack. Otherwise the request is deferred with eMBDeferRequest( ) or
+ * eMBDeferHandler( ) and completed when the coroutine returns. The frames
+ * of the coroutines and the buffers are taken from pools with
+ * MB_CO_FRAMES entries. No heap memory is used. If a pool is empty a
+ * <b>SLAVE DEVICE BUSY</b> exception is sent.
+ *
+ * Coroutines for writes and function handlers are only started if the
+ * request can be deferred. Otherwise a write could be applied although the
+ * master got an exception and repeats the request. Writes which can not be
+ * deferred, for example by the function 0x17 or if all MB_DEFER_SLOTS slots
+ * are in use, never run and the master gets an exception.
+ *
+ * The coroutines must only be resumed by MB::eMBCoPoll( ).
+ *
+ * \code
+ * static MB::MBCoSignal xAdcDone;
+ *
+ * MB::MBCoTask< eMBErrorCode >
+ * xReadAdc( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+ * {
+ *     vAdcStart( usAddress, usNRegs );
+ *     co_await xAdcDone;          // xAdcDone.vSet( ) in the ADC interrupt.
+ *     vAdcCopy( pucRegBuffer, usNRegs );
+ *     co_return MB_ENOERR;
+ * }
+ *
+ * eMBErrorCode
+ * eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+ * {
+ *     return MB::eMBCoRegInputCB< xReadAdc >( pucRegBuffer, usAddress, usNRegs );
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_coro
+ *  @{
+ */
+namespace MB
+{
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief A pool of fixed size blocks which can be used from any thread. */
+template< std::size_t N, std::size_t S >
+class MBCoPool
+{
+  public:
+    void           *pvAlloc( std::size_t xSize ) noexcept
+    {
+        void           *pvBlock = nullptr;
+        bool            xFree;
+
+        for( std::size_t i = 0; ( pvBlock == nullptr ) && ( xSize <= S ) && ( i < N ); i++ )
+        {
+            xFree = false;
+            if( axUsed[i].compare_exchange_strong( xFree, true, std::memory_order_acquire ) )
+            {
+                pvBlock = aucBlocks[i];
+            }
+        }
+        return pvBlock;
+    }
+
+    void            vFree( void *pvBlock ) noexcept
+    {
+        std::size_t     xIdx = ( static_cast< unsigned char * >( pvBlock ) - &aucBlocks[0][0] ) / S;
+
+        axUsed[xIdx].store( false, std::memory_order_release );
+    }
+
+  private:
+    static_assert( ( S % alignof( std::max_align_t ) ) == 0, "block size must keep the alignment" );
+
+    alignas( std::max_align_t ) unsigned char aucBlocks[N][S];
+    std::atomic< bool > axUsed[N] = { };
+};
+
+/*! \brief Buffer for the values or the PDU of a request. */
+struct MBCoBuffer
+{
+    USHORT          usLength;
+    UCHAR           aucData[MB_PDU_SIZE_MAX];
+};
+
+namespace Detail
+{
+constexpr std::size_t xMBCoAlign( std::size_t xSize )
+{
+    return ( xSize + alignof( std::max_align_t ) - 1 ) & ~( alignof( std::max_align_t ) - 1 );
+}
+
+inline MBCoPool< MB_CO_FRAMES, xMBCoAlign( MB_CO_FRAME_SIZE ) > xMBCoFramePool;
+inline MBCoPool< MB_CO_FRAMES, xMBCoAlign( sizeof( MBCoBuffer ) ) > xMBCoBufferPool;
+}
+
+/*! \brief Result of a coroutine which is executed by the protocol stack.
+ *
+ * \c T is eMBErrorCode for register callbacks and eMBException for
+ * function handlers.
+ */
+template< typename T >
+class MBCoTask
+{
+  public:
+    class           promise_type;
+    using           handle_type = std::coroutine_handle< promise_type >;
+
+    class           promise_type
+    {
+      public:
+        void           *operator new( std::size_t xSize ) noexcept
+        {
+            return Detail::xMBCoFramePool.pvAlloc( xSize );
+        }
+
+        void            operator delete( void *pvFrame ) noexcept
+        {
+            Detail::xMBCoFramePool.vFree( pvFrame );
+        }
+
+        static MBCoTask get_return_object_on_allocation_failure(  ) noexcept
+        {
+            return MBCoTask( nullptr );
+        }
+
+        MBCoTask        get_return_object(  ) noexcept
+        {
+            return MBCoTask( handle_type::from_promise( *this ) );
+        }
+
+        std::suspend_never initial_suspend(  ) noexcept
+        {
+            return { };
+        }
+
+        auto            final_suspend(  ) noexcept
+        {
+            return FinalAwaiter { };
+        }
+
+        void            return_value( T xValue ) noexcept
+        {
+            xResult = xValue;
+        }
+
+        void            unhandled_exception(  ) noexcept
+        {
+            std::terminate(  );
+        }
+
+        T               xResult { };
+        /* Set if the coroutine has been suspended. Called when it returns. */
+        void            ( *pvDone ) ( promise_type & xPromise ) = nullptr;
+        USHORT          usToken = 0;
+        MBCoBuffer     *pxBuffer = nullptr;
+    };
+
+    MBCoTask( MBCoTask && xOther ) noexcept:xHandle( xOther.xHandle )
+    {
+        xOther.xHandle = nullptr;
+    }
+
+    MBCoTask( const MBCoTask & ) = delete;
+    MBCoTask & operator=( const MBCoTask & ) = delete;
+
+    ~MBCoTask(  )
+    {
+        if( xHandle )
+        {
+            xHandle.destroy(  );
+        }
+    }
+
+    bool            xValid(  ) const noexcept
+    {
+        return static_cast< bool >( xHandle );
+    }
+
+    bool            xDone(  ) const noexcept
+    {
+        return xHandle.done(  );
+    }
+
+    T               xResult(  ) const noexcept
+    {
+        return xHandle.promise(  ).xResult;
+    }
+
+    /*! \brief Let the suspended coroutine call \c pvDone when it returns. */
+    void            vDetach( void ( *pvDone ) ( promise_type & ), USHORT usToken,
+                             MBCoBuffer * pxBuffer ) noexcept
+    {
+        xHandle.promise(  ).pvDone = pvDone;
+        xHandle.promise(  ).usToken = usToken;
+        xHandle.promise(  ).pxBuffer = pxBuffer;
+        xHandle = nullptr;
+    }
+
+  private:
+    struct FinalAwaiter
+    {
+        bool            await_ready(  ) noexcept
+        {
+            return false;
+        }
+
+        void            await_suspend( handle_type xDone ) noexcept
+        {
+            promise_type   &xPromise = xDone.promise(  );
+
+            /* A coroutine which finished synchronously is destroyed by its
+             * task. A detached one cleans up itself. */
+            if( xPromise.pvDone != nullptr )
+            {
+                xPromise.pvDone( xPromise );
+                xDone.destroy(  );
+            }
+        }
+
+        void            await_resume(  ) noexcept
+        {
+        }
+    };
+
+    explicit        MBCoTask( handle_type xNewHandle ) noexcept:xHandle( xNewHandle )
+    {
+    }
+
+    handle_type     xHandle;
+};
+
+/*! \brief Base of the awaitables which are resumed by eMBCoPoll( ). */
+class MBCoWaiter
+{
+  public:
+    virtual bool    xReady(  ) noexcept = 0;
+
+    /*! \brief Resume all coroutines whose condition is met. */
+    static void     vResumeReady(  ) noexcept
+    {
+        MBCoWaiter     *pxWaiter = pxWaiters;
+        MBCoWaiter     *pxNext;
+
+        /* Resumed coroutines can add new waiters to the list. */
+        pxWaiters = nullptr;
+        for( ; pxWaiter != nullptr; pxWaiter = pxNext )
+        {
+            pxNext = pxWaiter->pxNext;
+            if( pxWaiter->xReady(  ) )
+            {
+                pxWaiter->xHandle.resume(  );
+            }
+            else
+            {
+                pxWaiter->vEnqueue( pxWaiter->xHandle );
+            }
+        }
+    }
+
+  protected:
+    ~MBCoWaiter(  ) = default;
+
+    void            vEnqueue( std::coroutine_handle<> xNewHandle ) noexcept
+    {
+        xHandle = xNewHandle;
+        pxNext = pxWaiters;
+        pxWaiters = this;
+    }
+
+  private:
+    static inline MBCoWaiter *pxWaiters = nullptr;
+
+    MBCoWaiter     *pxNext = nullptr;
+    std::coroutine_handle<> xHandle;
+};
+
+/*! \brief An event which can be set from any thread or interrupt.
+ *
+ * Only one coroutine can wait for it at a time. Waiting resets it.
+ */
+class MBCoSignal:public MBCoWaiter
+{
+  public:
+    void            vSet(  ) noexcept
+    {
+        xSet.store( true, std::memory_order_release );
+    }
+
+    bool            await_ready(  ) noexcept
+    {
+        return xReady(  );
+    }
+
+    void            await_suspend( std::coroutine_handle<> xWaiting ) noexcept
+    {
+        vEnqueue( xWaiting );
+    }
+
+    void            await_resume(  ) noexcept
+    {
+    }
+
+    bool            xReady(  ) noexcept override
+    {
+        return xSet.exchange( false, std::memory_order_acq_rel );
+    }
+
+  private:
+    std::atomic< bool > xSet { false };
+};
+
+/*! \brief Wait at least the given number of microseconds.
+ *
+ * Requires ulMBPortGetTimestampUs( ).
+ */
+class MBCoDelay:public MBCoWaiter
+{
+  public:
+    explicit        MBCoDelay( ULONG ulNewDelayUs ) noexcept:ulStartUs( ulMBPortGetTimestampUs(  ) ),
+        ulDelayUs( ulNewDelayUs )
+    {
+    }
+
+    bool            await_ready(  ) noexcept
+    {
+        return xReady(  );
+    }
+
+    void            await_suspend( std::coroutine_handle<> xWaiting ) noexcept
+    {
+        vEnqueue( xWaiting );
+    }
+
+    void            await_resume(  ) noexcept
+    {
+    }
+
+    bool            xReady(  ) noexcept override
+    {
+        return ( ULONG )( ulMBPortGetTimestampUs(  ) - ulStartUs ) >= ulDelayUs;
+    }
+
+  private:
+    ULONG           ulStartUs;
+    ULONG           ulDelayUs;
+};
+
+namespace Detail
+{
+inline void
+vMBCoCompleteRequest( MBCoTask< eMBErrorCode >::promise_type & xPromise )
+{
+    ( void )eMBCompleteRequest( xPromise.usToken, xPromise.pxBuffer->aucData, xPromise.xResult );
+    xMBCoBufferPool.vFree( xPromise.pxBuffer );
+}
+
+inline void
+vMBCoCompleteHandler( MBCoTask< eMBException >::promise_type & xPromise )
+{
+    ( void )eMBCompleteHandler( xPromise.usToken, xPromise.pxBuffer->aucData,
+                                xPromise.pxBuffer->usLength, xPromise.xResult );
+    xMBCoBufferPool.vFree( xPromise.pxBuffer );
+}
+
+template< typename T >
+void
+vMBCoDrop( typename MBCoTask< T >::promise_type & xPromise )
+{
+    xMBCoBufferPool.vFree( xPromise.pxBuffer );
+}
+
+template< typename F >
+eMBErrorCode
+eMBCoRunRegCB( UCHAR * pucRegBuffer, USHORT usNBytes, bool xRead, F xStart )
+{
+    eMBErrorCode    eStatus = MB_ETIMEDOUT;
+    MBCoBuffer     *pxBuffer;
+    USHORT          usToken = 0;
+
+    pxBuffer = static_cast< MBCoBuffer * >( xMBCoBufferPool.pvAlloc( sizeof( MBCoBuffer ) ) );
+    if( pxBuffer != nullptr )
+    {
+        /* A write must never be applied if the master gets an exception.
+         * Therefore it only starts if the request can be deferred. An unused
+         * slot is released by vMBDeferCommit( ). */
+        if( !xRead )
+        {
+            eStatus = eMBDeferRequest( pucRegBuffer, 0, &usToken );
+            std::memcpy( pxBuffer->aucData, pucRegBuffer, usNBytes );
+        }
+        if( !xRead && ( eStatus != MB_EPENDING ) )
+        {
+            xMBCoBufferPool.vFree( pxBuffer );
+        }
+        else
+        {
+            MBCoTask< eMBErrorCode > xTask = xStart( pxBuffer->aucData );
+
+            if( !xTask.xValid(  ) )
+            {
+                eStatus = MB_ETIMEDOUT;
+                xMBCoBufferPool.vFree( pxBuffer );
+            }
+            else if( xTask.xDone(  ) )
+            {
+                eStatus = xTask.xResult(  );
+                if( xRead && ( eStatus == MB_ENOERR ) )
+                {
+                    std::memcpy( pucRegBuffer, pxBuffer->aucData, usNBytes );
+                }
+                xMBCoBufferPool.vFree( pxBuffer );
+            }
+            else
+            {
+                if( xRead )
+                {
+                    eStatus = eMBDeferRequest( pucRegBuffer, usNBytes, &usToken );
+                }
+                xTask.vDetach( ( eStatus == MB_EPENDING ) ? vMBCoCompleteRequest : vMBCoDrop< eMBErrorCode >,
+                               usToken, pxBuffer );
+            }
+        }
+    }
+    return eStatus;
+}
+}
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Adapter for eMBRegInputCB( ). */
+template< auto pxProvider >
+eMBErrorCode
+eMBCoRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+{
+    return Detail::eMBCoRunRegCB( pucRegBuffer, ( USHORT )( usNRegs * 2 ), true,
+                                  [=]( UCHAR * pucBuffer ) {
+                                  return pxProvider( pucBuffer, usAddress, usNRegs ); } );
+}
+
+/*! \brief Adapter for eMBRegHoldingCB( ). */
+template< auto pxProvider >
+eMBErrorCode
+eMBCoRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
+{
+    return Detail::eMBCoRunRegCB( pucRegBuffer, ( USHORT )( usNRegs * 2 ), eMode == MB_REG_READ,
+                                  [=]( UCHAR * pucBuffer ) {
+                                  return pxProvider( pucBuffer, usAddress, usNRegs, eMode ); } );
+}
+
+/*! \brief Adapter for eMBRegCoilsCB( ). */
+template< auto pxProvider >
+eMBErrorCode
+eMBCoRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNCoils, eMBRegisterMode eMode )
+{
+    return Detail::eMBCoRunRegCB( pucRegBuffer, ( USHORT )( ( usNCoils + 7 ) / 8 ), eMode == MB_REG_READ,
+                                  [=]( UCHAR * pucBuffer ) {
+                                  return pxProvider( pucBuffer, usAddress, usNCoils, eMode ); } );
+}
+
+/*! \brief Adapter for eMBRegDiscreteCB( ). */
+template< auto pxProvider >
+eMBErrorCode
+eMBCoRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete )
+{
+    return Detail::eMBCoRunRegCB( pucRegBuffer, ( USHORT )( ( usNDiscrete + 7 ) / 8 ), true,
+                                  [=]( UCHAR * pucBuffer ) {
+                                  return pxProvider( pucBuffer, usAddress, usNDiscrete ); } );
+}
+
+/*! \brief Function handler for eMBRegisterCB( ) which runs a coroutine.
+ *
+ * The coroutine has the signature of a function handler and returns an
+ * MBCoTask< eMBException >.
+ */
+template< auto pxHandler >
+eMBException
+eMBCoFuncHandler( UCHAR * pucFrame, USHORT * pusLength )
+{
+    eMBException    eException = MB_EX_SLAVE_BUSY;
+    MBCoBuffer     *pxBuffer;
+    USHORT          usToken = 0;
+
+    pxBuffer = static_cast< MBCoBuffer * >( Detail::xMBCoBufferPool.pvAlloc( sizeof( MBCoBuffer ) ) );
+    if( pxBuffer != nullptr )
+    {
+        /* The handler may write. Like a write callback it only starts if the
+         * request can be deferred. */
+        if( eMBDeferHandler( &usToken ) != MB_EPENDING )
+        {
+            Detail::xMBCoBufferPool.vFree( pxBuffer );
+        }
+        else
+        {
+            std::memcpy( pxBuffer->aucData, pucFrame, *pusLength );
+            pxBuffer->usLength = *pusLength;
+            MBCoTask< eMBException > xTask = pxHandler( pxBuffer->aucData, &pxBuffer->usLength );
+
+            if( !xTask.xValid(  ) )
+            {
+                Detail::xMBCoBufferPool.vFree( pxBuffer );
+            }
+            else if( xTask.xDone(  ) )
+            {
+                eException = xTask.xResult(  );
+                if( eException == MB_EX_NONE )
+                {
+                    std::memcpy( pucFrame, pxBuffer->aucData, pxBuffer->usLength );
+                    *pusLength = pxBuffer->usLength;
+                }
+                Detail::xMBCoBufferPool.vFree( pxBuffer );
+            }
+            else
+            {
+                xTask.vDetach( Detail::vMBCoCompleteHandler, usToken, pxBuffer );
+                eException = MB_EX_PENDING;
+            }
+        }
+    }
+    return eException;
+}
+
+/*! \brief Resume waiting coroutines and call eMBPoll( ). */
+inline eMBErrorCode
+eMBCoPoll(  )
+{
+    MBCoWaiter::vResumeReady(  );
+    return eMBPoll(  );
+}
+}
+
+/*! @} */
+
+#endif
@@ -0,0 +1,168 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_DEFER_H
+#define _MB_DEFER_H
+
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbproto.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_defer Deferred Completion
+ * \code #include "mbdefer.h" \endcode
+ *
+ * If MB_DEFER_ENABLED is set to <code>1</code> a register callback does not
+ * need to supply the values immediately. Instead it reserves a slot with
+ * eMBDeferRequest( ) and returns its result. The protocol stack keeps a copy
+ * of the request and eMBPoll( ) continues to serve other requests. Later the
+ * application calls eMBCompleteRequest( ) with the token, for example from
+ * another thread after an I2C transfer has finished. The next call of
+ * eMBPoll( ) without a pending event sends the response. If the request is
+ * not completed within MB_DEFER_TIMEOUT_US the exception
+ * MB_DEFER_TIMEOUT_EXCEPTION is sent instead.
+ * If the transport can not send the response, for example because another
+ * request is being received, it is sent by a later call. It is dropped if
+ * this is not possible within MB_DEFER_TIMEOUT_US.
+ *
+ * Requests can be deferred by the callbacks of the functions 0x01 to 0x06,
+ * 0x0F and 0x10. The buffer passed to a callback is reused for the next
+ * request. Therefore a write callback must copy the values before it
+ * returns. A function handler registered with eMBRegisterCB( ) can defer
+ * any request with eMBDeferHandler( ) and return the exception
+ * MB_EX_PENDING. It supplies the complete response with
+ * eMBCompleteHandler( ).
+ *
+ * \code
+ * eMBErrorCode
+ * eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+ * {
+ *     USHORT usToken;
+ *     eMBErrorCode eStatus;
+ *
+ *     eStatus = eMBDeferRequest( pucRegBuffer, usNRegs * 2, &usToken );
+ *     if( eStatus == MB_EPENDING )
+ *     {
+ *         vStartSensorRead( usToken, usAddress, usNRegs );
+ *     }
+ *     return eStatus;
+ * }
+ *
+ * // Called when the sensor has delivered the values.
+ * void
+ * vSensorReadDone( USHORT usToken, UCHAR * pucValues, BOOL xOk )
+ * {
+ *     ( void )eMBCompleteRequest( usToken, pucValues, xOk ? MB_ENOERR : MB_EIO );
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_defer
+ *  @{
+ */
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Defer the request which is currently executed.
+ *
+ * Must only be called from a register callback.
+ *
+ * \param pucRegBuffer The buffer passed to the callback.
+ * \param usNBytes Number of bytes the callback would have written to
+ *   the buffer. Must be 0 for write callbacks.
+ * \param pusToken The token for eMBCompleteRequest( ).
+ *
+ * \return eMBErrorCode::MB_EPENDING which must be returned by the callback.
+ *   If all MB_DEFER_SLOTS slots are in use eMBErrorCode::MB_ETIMEDOUT is
+ *   returned, which results in a <b>SLAVE DEVICE BUSY</b> exception.
+ *   eMBErrorCode::MB_EINVAL if the request can not be deferred.
+ */
+eMBErrorCode    eMBDeferRequest( UCHAR * pucRegBuffer, USHORT usNBytes,
+                                 USHORT * pusToken );
+
+/*! \brief Defer the request which is currently executed by a function
+ *   handler.
+ *
+ * The handler must return MB_EX_PENDING if this function returns
+ * eMBErrorCode::MB_EPENDING. Otherwise it should return
+ * <b>SLAVE DEVICE BUSY</b>.
+ *
+ * \param pusToken The token for eMBCompleteHandler( ).
+ */
+eMBErrorCode    eMBDeferHandler( USHORT * pusToken );
+
+/*! \brief Complete a deferred request.
+ *
+ * Can be called from any thread.
+ *
+ * \param usToken The token returned by eMBDeferRequest( ).
+ * \param pucData The values for a read request. These are usNBytes bytes
+ *   in the same format as a callback would have written them. Not used
+ *   for write requests and can be <code>NULL</code>.
+ * \param eStatus The result of the callback. If it is not
+ *   eMBErrorCode::MB_ENOERR an exception is sent.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the token is not valid, for example
+ *   because the request has already timed out. Otherwise
+ *   eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBCompleteRequest( USHORT usToken, const UCHAR * pucData,
+                                    eMBErrorCode eStatus );
+
+/*! \brief Complete a request deferred by eMBDeferHandler( ).
+ *
+ * Can be called from any thread.
+ *
+ * \param usToken The token returned by eMBDeferHandler( ).
+ * \param pucFrame The response PDU if \c eException is MB_EX_NONE.
+ * \param usLength Length of the response PDU.
+ * \param eException The result of the handler.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the token is not valid or the
+ *   response is invalid. In the latter case a <b>SLAVE DEVICE FAILURE</b>
+ *   exception is sent. Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBCompleteHandler( USHORT usToken, const UCHAR * pucFrame,
+                                    USHORT usLength, eMBException eException );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+#define MB_DEFER_HEADROOM               ( 7 )   /* Size of the MBAP header. */
+#define MB_DEFER_TAILROOM               ( 2 )   /* Size of the RTU checksum. */
+
+void            vMBDeferBegin( UCHAR ucUnit, UCHAR * pucFrame, USHORT usHeadroom );
+void            vMBDeferCommit( eMBException * peException );
+BOOL            xMBDeferPoll( UCHAR ** ppucFrame, UCHAR * pucUnit, USHORT * pusLength,
+                              eMBException * peException );
+void            vMBDeferSent( BOOL xSent );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -0,0 +1,93 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_DIAG_H
+#define _MB_DIAG_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/* ----------------------- Type definitions ---------------------------------*/
+
+/*! \brief Serial line counters returned by the <em>Diagnostics</em>
+ *   function. The order matches the sub-function codes 0x0B - 0x12.
+ */
+typedef enum
+{
+    MB_DIAG_CNT_BUS_MESSAGE,        /*!< Valid frames seen on the bus. */
+    MB_DIAG_CNT_BUS_COMM_ERROR,     /*!< Frames with a CRC/LRC error. */
+    MB_DIAG_CNT_BUS_EXCEPTION,      /*!< Exception responses sent. */
+    MB_DIAG_CNT_SLAVE_MESSAGE,      /*!< Frames addressed to this slave. */
+    MB_DIAG_CNT_SLAVE_NO_RESPONSE,  /*!< Requests not answered. */
+    MB_DIAG_CNT_SLAVE_NAK,          /*!< Negative acknowledge exceptions. */
+    MB_DIAG_CNT_SLAVE_BUSY,         /*!< Slave device busy exceptions. */
+    MB_DIAG_CNT_BUS_CHAR_OVERRUN,   /*!< Receive buffer overruns. */
+    MB_DIAG_CNT_MAX
+} eMBDiagCounter;
+
+/* ----------------------- Defines ------------------------------------------*/
+/*! \brief Flags for receive events in the communication event log. */
+#define MB_DIAG_EVENT_RX_COMM_ERROR     ( 0x02 )
+#define MB_DIAG_EVENT_RX_OVERRUN        ( 0x10 )
+#define MB_DIAG_EVENT_RX_BROADCAST      ( 0x40 )
+
+/* ----------------------- Internal hooks -----------------------------------*/
+#if ( MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0 ) || ( MB_FUNC_DIAG_COM_EVENT_ENABLED > 0 )
+extern volatile USHORT usMBDiagCounters[MB_DIAG_CNT_MAX];
+
+void            vMBDiagException( eMBException eException );
+
+#define MB_DIAG_INC( eCounter )         ( usMBDiagCounters[eCounter]++ )
+#define MB_DIAG_EXCEPTION( eException ) vMBDiagException( eException )
+#else
+#define MB_DIAG_INC( eCounter )
+#define MB_DIAG_EXCEPTION( eException )
+#endif
+
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+void            vMBDiagEventReceive( UCHAR ucEvent );
+void            vMBDiagEventSend( UCHAR ucFunctionCode, eMBException eException );
+void            vMBDiagEventRestart( BOOL xClearLog );
+
+#define MB_DIAG_EVENT_RX( ucEvent ) \
+    vMBDiagEventReceive( ucEvent )
+#define MB_DIAG_EVENT_TX( ucFunctionCode, eException ) \
+    vMBDiagEventSend( ucFunctionCode, eException )
+#else
+#define MB_DIAG_EVENT_RX( ucEvent )
+#define MB_DIAG_EVENT_TX( ucFunctionCode, eException )
+#endif
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
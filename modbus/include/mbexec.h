@@ -0,0 +1,97 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_EXEC_H
+#define _MB_EXEC_H
+
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbproto.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_exec Request Executor
+ * \code #include "mbexec.h" \endcode
+ *
+ * If MB_EXEC_ENABLED is set to <code>1</code> eMBPoll( ) does not call the
+ * function handlers itself. It copies each request into one of
+ * MB_EXEC_JOBS jobs and passes it to the port with xMBPortExecSubmit( ).
+ * The port runs the job on a worker thread by calling vMBExecRun( ). The
+ * reception and the transmission of frames stay on the thread which calls
+ * eMBPoll( ).
+ *
+ * Responses are sent in the order of the requests. A request for the
+ * functions 0x01 - 0x06, 0x0F, 0x10, 0x16 or 0x17 is only submitted if no
+ * earlier request which is not finished writes to an overlapping range, or
+ * if the request itself is a write, accesses an overlapping range. Other
+ * functions are executed by eMBPoll( ) after all earlier requests are
+ * finished and no later request is started before them. Reads of
+ * different or the same ranges can therefore run in parallel while writes
+ * stay serialized.
+ *
+ * The callbacks must be safe to be called from several threads at the
+ * same time for different ranges. If all jobs are in use a request is
+ * answered with a <b>SLAVE DEVICE BUSY</b> exception. This response is
+ * also sent after the responses of all earlier requests. Subscriptions
+ * can not be used because they call the callbacks from eMBPoll( ).
+ */
+/*! \addtogroup modbus_exec
+ *  @{
+ */
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Execute a job passed to xMBPortExecSubmit( ).
+ *
+ * Called by the port on a worker thread. The response is sent by a later
+ * call of eMBPoll( ).
+ *
+ * \param pvJob The job passed to xMBPortExecSubmit( ).
+ */
+void            vMBExecRun( void *pvJob );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+#define MB_EXEC_HEADROOM                ( 7 )   /* Size of the MBAP header. */
+#define MB_EXEC_TAILROOM                ( 2 )   /* Size of the RTU checksum. */
+
+void            vMBExecSubmit( UCHAR ucUnit, UCHAR * pucFrame, USHORT usLength,
+                               USHORT usHeadroom, pxMBFunctionHandler pxHandler );
+BOOL            xMBExecPoll( UCHAR ** ppucFrame, UCHAR * pucUnit, USHORT * pusLength,
+                             eMBException * peException );
+void            vMBExecSent( BOOL xSent );
+
+/* Called by the port if the connection to the master is lost. Drops the
+ * requests which are not started and all responses which are not sent. */
+void            vMBExecFlush( void );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -0,0 +1,111 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_FIFO_H
+#define _MB_FIFO_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_fifo FIFO Queues
+ * \code #include "mbfifo.h" \endcode
+ *
+ * The function <em>Read FIFO Queue</em> is served from ring buffers which
+ * are registered by the application with eMBFifoRegister( ). Values are
+ * added by a single producer, e.g. a sampling thread or an interrupt
+ * handler, with xMBFifoPush( ). The protocol stack is the only consumer.
+ * Because each index is only written by one side no locking is required.
+ *
+ * Contrary to the Modbus specification, which requires an exception if
+ * more than 31 values are queued, a request returns up to 31 values and
+ * removes them from the queue. The remaining values are returned by the
+ * next request. Values are removed when the response is built, so they
+ * are lost if the response does not reach the master.
+ *
+ * \code
+ * static xMBFifo  xVibration;
+ * static USHORT   usVibrationBuf[64];
+ *
+ * eMBFifoRegister( &xVibration, 1001, usVibrationBuf, 64 );
+ * ...
+ * // In the sampling interrupt.
+ * ( void )xMBFifoPush( &xVibration, usSample );
+ * \endcode
+ */
+/*! \addtogroup modbus_fifo
+ *  @{
+ */
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief A FIFO queue. The members are private to the protocol stack. */
+typedef struct
+{
+    USHORT          usAddress;      /*!< FIFO pointer address. */
+    USHORT         *pusBuffer;      /*!< Storage for the values. */
+    USHORT          usMask;         /*!< Size of the buffer minus one. */
+    volatile USHORT usHead;         /*!< Written by the producer. */
+    volatile USHORT usTail;         /*!< Written by the protocol stack. */
+} xMBFifo;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Register a FIFO queue.
+ *
+ * Must be called before the protocol stack is enabled.
+ *
+ * \param pxFifo The queue. Must stay valid while the protocol stack is
+ *   running.
+ * \param usAddress The FIFO pointer address. As for the register callbacks
+ *   this is the address from the request plus one.
+ * \param pusBuffer Storage for the queued values.
+ * \param usSize Number of values in \c pusBuffer. Must be a power of two.
+ *
+ * \return eMBErrorCode::MB_EINVAL if \c usSize is not a power of two or
+ *   eMBErrorCode::MB_ENORES if already MB_FUNC_READ_FIFO_MAX queues are
+ *   registered. Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBFifoRegister( xMBFifo * pxFifo, USHORT usAddress,
+                                 USHORT * pusBuffer, USHORT usSize );
+
+/*! \brief Add a value to a FIFO queue.
+ *
+ * This function may be called from an interrupt handler or another thread
+ * but there must only be one producer per queue.
+ *
+ * \return \c FALSE if the queue is full. In this case the value is dropped.
+ */
+BOOL            xMBFifoPush( xMBFifo * pxFifo, USHORT usValue );
+
+/*! @} */
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
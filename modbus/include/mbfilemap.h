@@ -0,0 +1,147 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_FILEMAP_H
+#define _MB_FILEMAP_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_filemap File Record Mappings
+ * \code #include "mbfilemap.h" \endcode
+ *
+ * If MB_FUNC_FILE_MAP_ENABLED is set to <code>1</code> the functions
+ * <em>Read File Record</em> and <em>Write File Record</em> are served from
+ * memory regions registered with eMBFileMapRegister( ) instead of the
+ * callbacks eMBRegFileCB( ) and eMBRegFileVecCB( ). A region can be
+ * a memory mapped file, a flash region or plain RAM. The records are
+ * copied directly between the region and the PDU.
+ *
+ * A file has at most 10000 records. Larger regions continue with the
+ * next file numbers, i.e. record \c r of file \c f is located at the byte
+ * offset <tt>( ( f - usFileNumber ) * 10000 + r ) * 2</tt>. A region of
+ * 1MB therefore covers 27 file numbers.
+ *
+ * Writes are not flushed immediately. The modified range of each region
+ * is tracked and passed to the sync callback when the application calls
+ * vMBFileMapSync( ), e.g. from an idle loop or a timer. For a file mapped
+ * with mmap( ) the callback could look like
+ *
+ * \code
+ * static void
+ * vFileSync( xMBFileMap * pxMap, ULONG ulOffset, ULONG ulLength )
+ * {
+ *     ULONG ulPage = ulOffset & ~( ULONG )( sysconf( _SC_PAGESIZE ) - 1 );
+ *
+ *     msync( pxMap->pucData + ulPage, ulLength + ulOffset - ulPage, MS_ASYNC );
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_filemap
+ *  @{
+ */
+/* ----------------------- Defines ------------------------------------------*/
+/*! \brief The region can be read. */
+#define MB_FILE_MAP_READ            ( 0x01 )
+/*! \brief The region can be written. */
+#define MB_FILE_MAP_WRITE           ( 0x02 )
+/*! \brief The region stores the records in big endian byte order, which
+ *   is the byte order of the PDU. Otherwise it stores 16 bit words in the
+ *   byte order of the host and must be aligned to 2 bytes.
+ */
+#define MB_FILE_MAP_BIG_ENDIAN      ( 0x04 )
+
+/*! \brief Number of records in a file. */
+#define MB_FILE_MAP_RECORDS         ( 10000UL )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct xMBFileMapStruct xMBFileMap;
+
+/*! \brief Called by vMBFileMapSync( ) for the modified byte range of a
+ *   region.
+ */
+typedef void    ( *pxMBFileMapSync ) ( xMBFileMap * pxMap, ULONG ulOffset,
+                                       ULONG ulLength );
+
+/*! \brief A mapped region. Only \c pucData and \c ulLength may be used by
+ *   the application.
+ */
+struct xMBFileMapStruct
+{
+    UCHAR          *pucData;        /*!< Start of the region. */
+    ULONG           ulLength;       /*!< Length of the region in bytes. */
+    USHORT          usFileNumber;   /*!< File number of the first record. */
+    UCHAR           ucFlags;        /*!< MB_FILE_MAP_READ, ... */
+    pxMBFileMapSync pxSync;         /*!< Sync callback or NULL. */
+    ULONG           ulDirtyStart;   /*!< First modified byte. */
+    ULONG           ulDirtyEnd;     /*!< Last modified byte plus one. */
+};
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Register a region for the file record functions.
+ *
+ * Must be called before the protocol stack is enabled.
+ *
+ * \param pxMap Storage for the mapping. Must stay valid while the protocol
+ *   stack is running.
+ * \param usFileNumber The file number of the first record.
+ * \param pvData Start of the region.
+ * \param ulLength Length of the region in bytes.
+ * \param ucFlags A combination of MB_FILE_MAP_READ, MB_FILE_MAP_WRITE and
+ *   MB_FILE_MAP_BIG_ENDIAN.
+ * \param pxSync Callback for modified data or \c NULL.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the arguments are not valid and
+ *   eMBErrorCode::MB_ENORES if already MB_FUNC_FILE_MAP_MAX regions are
+ *   registered. Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBFileMapRegister( xMBFileMap * pxMap, USHORT usFileNumber,
+                                    void *pvData, ULONG ulLength, UCHAR ucFlags,
+                                    pxMBFileMapSync pxSync );
+
+/*! \brief Pass the modified ranges of all regions to their sync callbacks.
+ *
+ * The function may be called from another thread than eMBPoll( ). The
+ * callbacks are called outside of the critical section.
+ */
+void            vMBFileMapSync( void );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+eMBErrorCode    eMBFileMapCB( xMBFileRequest * pxRequests, USHORT usNRequests,
+                              eMBRegisterMode eMode );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -37,6 +37,10 @@ PR_BEGIN_EXTERN_C
     eMBException eMBFuncReportSlaveID( UCHAR * pucFrame, USHORT * usLen );
 #endif
 
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+eMBException    eMBFuncEncapInterface( UCHAR * pucFrame, USHORT * usLen );
+#endif
+
 #if MB_FUNC_READ_INPUT_ENABLED > 0
 eMBException    eMBFuncReadInputRegister( UCHAR * pucFrame, USHORT * usLen );
 #endif
@@ -61,6 +65,14 @@ eMBException    eMBFuncReadCoils( UCHAR * pucFrame, USHORT * usLen );
 eMBException    eMBFuncWriteCoil( UCHAR * pucFrame, USHORT * usLen );
 #endif
 
+#if MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0
+eMBException    eMBFuncMaskWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen );
+#endif
+
+#if MB_FUNC_READ_FIFO_ENABLED > 0
+eMBException    eMBFuncReadFifoQueue( UCHAR * pucFrame, USHORT * usLen );
+#endif
+
 #if MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0
 eMBException    eMBFuncWriteMultipleCoils( UCHAR * pucFrame, USHORT * usLen );
 #endif
@@ -81,6 +93,15 @@ eMBException    eMBFuncWriteFileRecord( UCHAR * pucFrame, USHORT * usLen );
 eMBException    eMBFuncReadFileRecord( UCHAR * pucFrame, USHORT * usLen );
 #endif
 
+#if MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0
+eMBException    eMBFuncDiagnostic( UCHAR * pucFrame, USHORT * usLen );
+#endif
+
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+eMBException    eMBFuncGetCommEventCounter( UCHAR * pucFrame, USHORT * usLen );
+eMBException    eMBFuncGetCommEventLog( UCHAR * pucFrame, USHORT * usLen );
+#endif
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
@@ -0,0 +1,103 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_HOOKS_H
+#define _MB_HOOKS_H
+
+#include "mbconfig.h"
+#if MB_JOURNAL_ENABLED > 0
+#include "mbjournal.h"
+#endif
+#if MB_SUBSCRIBE_ENABLED > 0
+#include "mbsubscribe.h"
+#endif
+#if MB_CACHE_ENABLED > 0
+#include "mbcache.h"
+#endif
+
+/* ----------------------- Defines ------------------------------------------*/
+/* MB_HOOK_WRITE( ) is called by the function handlers after registers or
+ * coils have been written successfully. The table is one of the values of
+ * eMBRegMapTable and the address is the one passed to the callbacks.
+ * Features which need to know about writes add their calls here, so the
+ * handlers are not changed for every new feature.
+ *
+ * MB_HOOK_REQUEST_CACHED( ) is called by eMBPoll( ) before the function
+ * handler. If it returns TRUE it has replaced the request with the response
+ * and the handler is not called. Otherwise MB_HOOK_RESPONSE( ) is called
+ * with the response of the handler if there was no exception.
+ *
+ * MB_HOOK_REQUEST_DONE( ) is called by eMBPoll( ) after a request has been
+ * executed and the response has been passed to the transport layer.
+ * MB_HOOK_IDLE( ) is called by eMBPoll( ) if there was nothing to do. It
+ * must return quickly if there is no work.
+ */
+#if MB_JOURNAL_ENABLED > 0
+#define MB_HOOK_WRITE_JOURNAL( eTable, usAddress, usNRegs ) \
+    vMBJournalAppend( ( eTable ), ( usAddress ), ( usNRegs ) )
+#else
+#define MB_HOOK_WRITE_JOURNAL( eTable, usAddress, usNRegs )
+#endif
+
+#if MB_SUBSCRIBE_ENABLED > 0
+#define MB_HOOK_WRITE_SUBSCRIBE( eTable, usAddress, usNRegs ) \
+    vMBSubscriptionNotify( ( eTable ), ( usAddress ), ( usNRegs ) )
+#define MB_HOOK_REQUEST_DONE( ) \
+    vMBSubscriptionDispatch(  )
+#define MB_HOOK_IDLE( ) \
+    vMBSubscriptionDispatchChanged(  )
+#else
+#define MB_HOOK_WRITE_SUBSCRIBE( eTable, usAddress, usNRegs )
+#define MB_HOOK_REQUEST_DONE( )
+#define MB_HOOK_IDLE( )
+#endif
+
+#if MB_CACHE_ENABLED > 0
+#define MB_HOOK_WRITE_CACHE( eTable, usAddress, usNRegs ) \
+    vMBCacheInvalidate( ( eTable ), ( usAddress ), ( usNRegs ) )
+#define MB_HOOK_REQUEST_CACHED( ucUnit, pucFrame, pusLength ) \
+    xMBCacheLookup( ( ucUnit ), ( pucFrame ), ( pusLength ) )
+#define MB_HOOK_RESPONSE( pucFrame, usLength ) \
+    vMBCacheStore( ( pucFrame ), ( usLength ) )
+#else
+#define MB_HOOK_WRITE_CACHE( eTable, usAddress, usNRegs )
+#define MB_HOOK_REQUEST_CACHED( ucUnit, pucFrame, pusLength ) \
+    FALSE
+#define MB_HOOK_RESPONSE( pucFrame, usLength )
+#endif
+
+#define MB_HOOK_WRITE( eTable, usAddress, usNRegs ) \
+    do \
+    { \
+        MB_HOOK_WRITE_JOURNAL( eTable, usAddress, usNRegs ); \
+        MB_HOOK_WRITE_SUBSCRIBE( eTable, usAddress, usNRegs ); \
+        MB_HOOK_WRITE_CACHE( eTable, usAddress, usNRegs ); \
+    } while( 0 )
+
+#endif
@@ -0,0 +1,110 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_JOURNAL_H
+#define _MB_JOURNAL_H
+
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbregmap.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_journal Write Journal
+ * \code #include "mbjournal.h" \endcode
+ *
+ * If MB_JOURNAL_ENABLED is set to <code>1</code> every successful write of
+ * holding registers or coils by the master appends a record to a journal.
+ * The application drains the journal with usMBJournalDrain( ) and only has
+ * to look at the changed registers.
+ *
+ * The journal is a lock free ring buffer with MB_JOURNAL_SIZE records. Any
+ * number of producers can append records with vMBJournalAppend( ), e.g.
+ * application threads which change registers themselves. There must only
+ * be one consumer. If the journal is full new records are dropped and the
+ * next drain reports an overflow. The consumer must then assume that all
+ * registers have changed.
+ *
+ * \code
+ * xMBJournalRecord xRecords[16];
+ * USHORT          usIdx, usN;
+ * BOOL            xOverflow;
+ *
+ * while( ( usN = usMBJournalDrain( xRecords, 16, &xOverflow ) ) > 0 )
+ * {
+ *     for( usIdx = 0; usIdx < usN; usIdx++ )
+ *     {
+ *         vApplySetpoints( xRecords[usIdx].usAddress, xRecords[usIdx].usNRegs );
+ *     }
+ * }
+ * if( xOverflow )
+ * {
+ *     vApplyAllSetpoints(  );
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_journal
+ *  @{
+ */
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief A change of registers or coils. */
+typedef struct
+{
+    ULONG           ulSequence;     /*!< Incremented for every record. */
+    eMBRegMapTable  eTable;         /*!< MB_REG_MAP_HOLDING or MB_REG_MAP_COILS. */
+    USHORT          usAddress;      /*!< First address as passed to the callbacks. */
+    USHORT          usNRegs;        /*!< Number of registers or coils. */
+} xMBJournalRecord;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Append a record to the journal.
+ *
+ * Can be called from several threads at the same time. If the journal is
+ * full the record is dropped.
+ */
+void            vMBJournalAppend( eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs );
+
+/*! \brief Remove records from the journal.
+ *
+ * \param pxRecords Buffer for the records.
+ * \param usMax Size of the buffer.
+ * \param pxOverflow Set to \c TRUE if records were dropped since the last
+ *   call. Otherwise \c FALSE.
+ *
+ * \return The number of records copied to the buffer.
+ */
+USHORT          usMBJournalDrain( xMBJournalRecord * pxRecords, USHORT usMax, BOOL * pxOverflow );
+
+/*! @} */
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
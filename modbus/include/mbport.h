@@ -94,6 +94,21 @@ void            vMBPortTimersDisable( void );
 
 void            vMBPortTimersDelay( USHORT usTimeOutMS );
 
+/*! \brief Free running timestamp in microseconds.
+ *
+ * Only required if MB_STATS_LATENCY_ENABLED, MB_CACHE_ENABLED or
+ * MB_DEFER_ENABLED is set. The value is allowed to wrap around.
+ */
+ULONG           ulMBPortGetTimestampUs( void );
+
+/* ----------------------- Executor functions -------------------------------*/
+/*! \brief Run a job on a worker thread.
+ *
+ * Only required if MB_EXEC_ENABLED is set. The port must call vMBExecRun( )
+ * with the job. If it returns FALSE the job is executed by eMBPoll( ).
+ */
+BOOL            xMBPortExecSubmit( void *pvJob );
+
 /* ----------------------- Callback for the protocol stack ------------------*/
 
 /*!
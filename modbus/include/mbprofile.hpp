@@ -0,0 +1,595 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_PROFILE_HPP
+#define _MB_PROFILE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "port.h"
+#include "mb.h"
+#include "mbregmap.h"
+#include "mbvalue.h"
+
+/*! \defgroup modbus_profile C++ Device Profiles
+ * \code #include "mbprofile.hpp" \endcode
+ *
+ * A device profile describes the registers of a device as C++ types. Each
+ * point binds an address to a variable:
+ *  - MB::MBReg stores a 16, 32 or 64 bit integer or floating point
+ *    variable in one, two or four registers. Multi register values use the
+ *    byte orders of mbvalue.h.
+ *  - MB::MBScaled stores a floating point variable multiplied by a constant
+ *    factor as a signed 16 bit register. Values out of range are clamped.
+ *  - MB::MBBit stores a \c bool or integer variable as a coil or a
+ *    discrete input.
+ *
+ * MB::MBTable groups the points of a register table and MB::MBProfile
+ * groups the tables of a device. All checks are done by the compiler.
+ * Points must not overlap, input registers and discrete inputs must not be
+ * writable and a table must only contain points of its kind. For each
+ * table the compiler generates one constant entry per address between the
+ * first and the last point. They are placed in read only memory. A request
+ * is checked with one compare and then served by indexing the entries.
+ * There is no search and no RAM is used apart from the variables.
+ * Addresses between the points occupy 3 bytes each and are answered with
+ * an <b>ILLEGAL DATA ADDRESS</b> exception. Multi register values must be
+ * written completely.
+ *
+ * A profile provides static register callbacks. It can be used as the
+ * register map of MB::MBSlave, which then supports only the function codes
+ * for the tables in the profile. For eMBPoll( ) MB_PROFILE_CALLBACKS( )
+ * defines the C callbacks.
+ *
+ * \code
+ * static USHORT   usSetpoint;
+ * static float    fTemperature;
+ * static float    fVoltage;
+ * static bool     xRelay;
+ *
+ * using xDevice = MB::MBProfile<
+ *     MB::MBTable< MB_REG_MAP_HOLDING,
+ *                  MB::MBReg< 1000, &usSetpoint, MB_REG_MAP_READ | MB_REG_MAP_WRITE > >,
+ *     MB::MBTable< MB_REG_MAP_INPUT,
+ *                  MB::MBReg< 1, &fTemperature, MB_REG_MAP_READ, MB_VALUE_CDAB >,
+ *                  MB::MBScaled< 3, &fVoltage, 100 > >,
+ *     MB::MBTable< MB_REG_MAP_COILS,
+ *                  MB::MBBit< 1, &xRelay, MB_REG_MAP_READ | MB_REG_MAP_WRITE > > >;
+ *
+ * MB_PROFILE_CALLBACKS( xDevice )
+ * \endcode
+ */
+/*! \addtogroup modbus_profile
+ *  @{
+ */
+namespace MB
+{
+namespace Detail
+{
+/* ----------------------- Helpers ------------------------------------------*/
+template< std::size_t N >
+using           MBProfileBits = std::conditional_t< N == 2, std::uint16_t,
+    std::conditional_t< N == 4, std::uint32_t, std::uint64_t > >;
+
+/* Same rule as in mbvalue.c. The byte at offset i of a big endian value
+ * is stored at offset i ^ SWAP in the buffer. */
+template< typename T >
+constexpr UCHAR
+ucMBProfileSwap( eMBValueOrder eOrder )
+{
+    UCHAR           ucSwap = 0;
+
+    if constexpr( sizeof( T ) == 4 )
+    {
+        ucSwap = ( UCHAR )eOrder;
+    }
+    else if constexpr( sizeof( T ) == 8 )
+    {
+        ucSwap = ( UCHAR )( ( eOrder & 1 ) | ( ( eOrder & 2 ) * 3 ) );
+    }
+    return ucSwap;
+}
+
+template< typename T, UCHAR ucSwap >
+inline void
+vMBProfileStore( UCHAR * pucBuf, T xValue )
+{
+    MBProfileBits< sizeof( T ) > xBits = std::bit_cast< MBProfileBits< sizeof( T ) > >( xValue );
+
+    for( std::size_t i = 0; i < sizeof( T ); i++ )
+    {
+        pucBuf[i ^ ucSwap] = ( UCHAR )( xBits >> ( 8 * ( sizeof( T ) - 1 - i ) ) );
+    }
+}
+
+template< typename T, UCHAR ucSwap >
+inline          T
+xMBProfileLoad( const UCHAR * pucBuf )
+{
+    MBProfileBits< sizeof( T ) > xBits = 0;
+
+    for( std::size_t i = 0; i < sizeof( T ); i++ )
+    {
+        xBits = ( MBProfileBits< sizeof( T ) > )( ( xBits << 8 ) | pucBuf[i ^ ucSwap] );
+    }
+    return std::bit_cast< T >( xBits );
+}
+
+template< auto pxVar >
+using           MBProfileVar = std::remove_cv_t< std::remove_pointer_t< decltype( pxVar ) > >;
+}
+
+/* ----------------------- Points -------------------------------------------*/
+/*! \brief A variable stored in one or more registers.
+ *
+ * \tparam usAddr First address as passed to the callbacks.
+ * \tparam pxVar Address of a variable with static storage duration.
+ * \tparam ucAccess MB_REG_MAP_READ and/or MB_REG_MAP_WRITE.
+ * \tparam eOrder Byte order of 32 and 64 bit values.
+ */
+template< USHORT usAddr, auto pxVar, UCHAR ucAccess = MB_REG_MAP_READ, eMBValueOrder eOrder = MB_VALUE_ABCD >
+struct MBReg
+{
+    using           T = Detail::MBProfileVar< pxVar >;
+
+    static_assert( std::is_arithmetic_v< T > && !std::is_same_v< T, bool > &&
+                   ( ( sizeof( T ) == 2 ) || ( sizeof( T ) == 4 ) || ( sizeof( T ) == 8 ) ),
+                   "MBReg needs a 16, 32 or 64 bit variable" );
+
+    static constexpr USHORT usAddress = usAddr;
+    static constexpr USHORT usNRegs = sizeof( T ) / 2;
+    static constexpr UCHAR ucFlags = ucAccess;
+    static constexpr bool xBit = false;
+
+    static void     vEncode( UCHAR * pucRegs )
+    {
+        Detail::vMBProfileStore< T, Detail::ucMBProfileSwap< T >( eOrder ) >( pucRegs, *pxVar );
+    }
+
+    static void     vDecode( const UCHAR * pucRegs )
+    {
+        *pxVar = Detail::xMBProfileLoad< T, Detail::ucMBProfileSwap< T >( eOrder ) >( pucRegs );
+    }
+};
+
+/*! \brief A floating point variable stored as a signed 16 bit register.
+ *
+ * The register holds the value multiplied by \c lScale and rounded.
+ */
+template< USHORT usAddr, auto pxVar, long lScale, UCHAR ucAccess = MB_REG_MAP_READ >
+struct MBScaled
+{
+    using           T = Detail::MBProfileVar< pxVar >;
+
+    static_assert( std::is_floating_point_v< T >, "MBScaled needs a floating point variable" );
+    static_assert( lScale != 0, "MBScaled needs a scale other than 0" );
+
+    static constexpr USHORT usAddress = usAddr;
+    static constexpr USHORT usNRegs = 1;
+    static constexpr UCHAR ucFlags = ucAccess;
+    static constexpr bool xBit = false;
+
+    static void     vEncode( UCHAR * pucRegs )
+    {
+        T               xValue = *pxVar * ( T ) lScale;
+        std::int16_t    sRaw;
+
+        if( xValue >= ( T ) 32767 )
+        {
+            sRaw = 32767;
+        }
+        else if( xValue <= ( T ) - 32768 )
+        {
+            sRaw = -32768;
+        }
+        else
+        {
+            sRaw = ( std::int16_t )( ( xValue >= 0 ) ? ( xValue + ( T ) 0.5 ) : ( xValue - ( T ) 0.5 ) );
+        }
+        Detail::vMBProfileStore< std::int16_t, 0 >( pucRegs, sRaw );
+    }
+
+    static void     vDecode( const UCHAR * pucRegs )
+    {
+        *pxVar = ( T ) Detail::xMBProfileLoad< std::int16_t, 0 >( pucRegs ) / ( T ) lScale;
+    }
+};
+
+/*! \brief A \c bool or integer variable stored as a coil or a discrete input. */
+template< USHORT usAddr, auto pxVar, UCHAR ucAccess = MB_REG_MAP_READ >
+struct MBBit
+{
+    using           T = Detail::MBProfileVar< pxVar >;
+
+    static_assert( std::is_integral_v< T >, "MBBit needs a bool or an integer variable" );
+
+    static constexpr USHORT usAddress = usAddr;
+    static constexpr USHORT usNRegs = 1;
+    static constexpr UCHAR ucFlags = ucAccess;
+    static constexpr bool xBit = true;
+
+    /* The value of the bit is passed in bit 0 of the byte. */
+    static void     vEncode( UCHAR * pucBit )
+    {
+        *pucBit = ( *pxVar ) ? 1 : 0;
+    }
+
+    static void     vDecode( const UCHAR * pucBit )
+    {
+        *pxVar = ( T ) ( *pucBit & 1 );
+    }
+};
+
+/* ----------------------- Tables -------------------------------------------*/
+/*! \brief The points of one register table. */
+template< eMBRegMapTable eTab, class... Points >
+class MBTable
+{
+  public:
+    static constexpr eMBRegMapTable eTable = eTab;
+
+  private:
+    /* An entry for every address in the span of the table. ucPoint is the
+     * index of the point plus one or 0 if the address is not mapped. */
+    struct xMBProfileEntry
+    {
+        UCHAR           ucPoint;
+        UCHAR           ucOffset;
+        UCHAR           ucFlags;
+    };
+
+    static constexpr std::size_t xNPoints = sizeof...( Points );
+    static constexpr bool xBitTable = ( eTab == MB_REG_MAP_COILS ) || ( eTab == MB_REG_MAP_DISCRETE );
+    static constexpr std::array< USHORT, xNPoints > ausAddress = { Points::usAddress... };
+    static constexpr std::array< USHORT, xNPoints > ausNRegs = { Points::usNRegs... };
+
+    static constexpr USHORT usMBFirst(  )
+    {
+        USHORT          usFirst = 0xFFFF;
+
+        for( std::size_t i = 0; i < xNPoints; i++ )
+        {
+            usFirst = ( ausAddress[i] < usFirst ) ? ausAddress[i] : usFirst;
+        }
+        return usFirst;
+    }
+
+    static constexpr ULONG ulMBEnd(  )
+    {
+        ULONG           ulEnd = 0;
+
+        for( std::size_t i = 0; i < xNPoints; i++ )
+        {
+            ulEnd = ( ( ULONG )ausAddress[i] + ausNRegs[i] > ulEnd ) ? ( ULONG )ausAddress[i] + ausNRegs[i] : ulEnd;
+        }
+        return ulEnd;
+    }
+
+    static constexpr bool xMBDisjoint(  )
+    {
+        bool            xDisjoint = true;
+
+        for( std::size_t i = 0; i < xNPoints; i++ )
+        {
+            for( std::size_t j = i + 1; j < xNPoints; j++ )
+            {
+                if( ( ausAddress[i] < ausAddress[j] + ausNRegs[j] ) &&
+                    ( ausAddress[j] < ausAddress[i] + ausNRegs[i] ) )
+                {
+                    xDisjoint = false;
+                }
+            }
+        }
+        return xDisjoint;
+    }
+
+    static_assert( ( xNPoints >= 1 ) && ( xNPoints <= 255 ), "a table needs 1 to 255 points" );
+    static_assert( eTab < MB_REG_MAP_TABLES, "invalid table" );
+    static_assert( ( ( Points::xBit == xBitTable ) && ... ),
+                   "coils and discrete inputs need MBBit, registers need MBReg or MBScaled" );
+    static_assert( ( ( Points::usAddress >= 1 ) && ... ), "addresses passed to the callbacks start at 1" );
+    static_assert( ( ( ( Points::ucFlags & ~( MB_REG_MAP_READ | MB_REG_MAP_WRITE ) ) == 0 ) && ... ),
+                   "only MB_REG_MAP_READ and MB_REG_MAP_WRITE are allowed" );
+    static_assert( ( ( eTab != MB_REG_MAP_INPUT ) && ( eTab != MB_REG_MAP_DISCRETE ) ) ||
+                   ( ( ( Points::ucFlags & MB_REG_MAP_WRITE ) == 0 ) && ... ),
+                   "input registers and discrete inputs can not be written" );
+    static_assert( xMBDisjoint(  ), "points must not overlap" );
+    static_assert( ulMBEnd(  ) <= 0x10000UL, "points exceed the address space" );
+
+    static constexpr USHORT usFirst = usMBFirst(  );
+    static constexpr USHORT usSpan = ( USHORT )( ulMBEnd(  ) - usFirst );
+
+    static constexpr std::array< xMBProfileEntry, usSpan > axMBEntries(  )
+    {
+        std::array< xMBProfileEntry, usSpan > axEntries = { };
+        constexpr std::array< UCHAR, xNPoints > aucFlags = { Points::ucFlags... };
+
+        for( std::size_t i = 0; i < xNPoints; i++ )
+        {
+            for( USHORT j = 0; j < ausNRegs[i]; j++ )
+            {
+                axEntries[ausAddress[i] - usFirst + j] = { ( UCHAR )( i + 1 ), ( UCHAR )j, aucFlags[i] };
+            }
+        }
+        return axEntries;
+    }
+
+    static constexpr std::array< xMBProfileEntry, usSpan > axEntries = axMBEntries(  );
+    static constexpr std::array< void ( * )( UCHAR * ), xNPoints > apvEncode = { &Points::vEncode... };
+    static constexpr std::array< void ( * )( const UCHAR * ), xNPoints > apvDecode = { &Points::vDecode... };
+
+    /* Checks that all addresses are mapped with the access right. Writes
+     * must not start or end inside a multi register value. */
+    static bool     xMBCheck( USHORT usAddress, USHORT usNRegs, UCHAR ucAccess )
+    {
+        bool            xValid = false;
+        USHORT          usIdx = ( USHORT )( usAddress - usFirst );
+
+        if( ( usAddress >= usFirst ) && ( ( ULONG )usIdx + usNRegs <= usSpan ) )
+        {
+            xValid = true;
+            for( USHORT i = 0; i < usNRegs; i++ )
+            {
+                if( ( axEntries[usIdx + i].ucFlags & ucAccess ) == 0 )
+                {
+                    xValid = false;
+                }
+            }
+            if( xValid && ( ucAccess == MB_REG_MAP_WRITE ) &&
+                ( ( axEntries[usIdx].ucOffset != 0 ) ||
+                  ( ( usIdx + usNRegs < usSpan ) && ( axEntries[usIdx + usNRegs].ucOffset != 0 ) ) ) )
+            {
+                xValid = false;
+            }
+        }
+        return xValid;
+    }
+
+  public:
+    /*! \brief Reads or writes registers. Has the arguments of eMBRegHoldingCB( ). */
+    static eMBErrorCode eMBProfileRegs( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
+        requires( !xBitTable )
+    {
+        eMBErrorCode    eStatus = MB_ENOERR;
+        USHORT          usIdx = ( USHORT )( usAddress - usFirst );
+        USHORT          usCnt;
+        UCHAR           aucValue[8];
+        const xMBProfileEntry *pxEntry;
+
+        if( !xMBCheck( usAddress, usNRegs, ( eMode == MB_REG_READ ) ? MB_REG_MAP_READ : MB_REG_MAP_WRITE ) )
+        {
+            eStatus = MB_ENOREG;
+        }
+        else
+        {
+            for( USHORT i = 0; i < usNRegs; i += usCnt )
+            {
+                pxEntry = &axEntries[usIdx + i];
+                usCnt = ( USHORT )( ausNRegs[pxEntry->ucPoint - 1] - pxEntry->ucOffset );
+                if( eMode == MB_REG_READ )
+                {
+                    usCnt = ( usCnt < usNRegs - i ) ? usCnt : ( USHORT )( usNRegs - i );
+                    apvEncode[pxEntry->ucPoint - 1] ( aucValue );
+                    std::memcpy( &pucRegBuffer[2 * i], &aucValue[2 * pxEntry->ucOffset], 2 * usCnt );
+                }
+                else
+                {
+                    apvDecode[pxEntry->ucPoint - 1] ( &pucRegBuffer[2 * i] );
+                }
+            }
+        }
+        return eStatus;
+    }
+
+    /*! \brief Reads or writes bits. Has the arguments of eMBRegCoilsCB( ). */
+    static eMBErrorCode eMBProfileBits( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNBits, eMBRegisterMode eMode )
+        requires( xBitTable )
+    {
+        eMBErrorCode    eStatus = MB_ENOERR;
+        USHORT          usIdx = ( USHORT )( usAddress - usFirst );
+        UCHAR           ucBit;
+
+        if( !xMBCheck( usAddress, usNBits, ( eMode == MB_REG_READ ) ? MB_REG_MAP_READ : MB_REG_MAP_WRITE ) )
+        {
+            eStatus = MB_ENOREG;
+        }
+        else if( eMode == MB_REG_READ )
+        {
+            std::memset( pucRegBuffer, 0, ( usNBits + 7 ) / 8 );
+            for( USHORT i = 0; i < usNBits; i++ )
+            {
+                apvEncode[axEntries[usIdx + i].ucPoint - 1] ( &ucBit );
+                pucRegBuffer[i / 8] |= ( UCHAR )( ucBit << ( i % 8 ) );
+            }
+        }
+        else
+        {
+            for( USHORT i = 0; i < usNBits; i++ )
+            {
+                ucBit = ( UCHAR )( pucRegBuffer[i / 8] >> ( i % 8 ) );
+                apvDecode[axEntries[usIdx + i].ucPoint - 1] ( &ucBit );
+            }
+        }
+        return eStatus;
+    }
+};
+
+namespace Detail
+{
+/* The table of the profile for eTable or void. */
+template< eMBRegMapTable eTable, class... Tables >
+struct MBProfileFind
+{
+    using           type = void;
+};
+
+template< eMBRegMapTable eTable, class Table, class... Tables >
+struct MBProfileFind< eTable, Table, Tables... >
+{
+    using           type = std::conditional_t< Table::eTable == eTable, Table,
+        typename MBProfileFind< eTable, Tables... >::type >;
+};
+}
+
+/* ----------------------- Profiles -----------------------------------------*/
+/*! \brief The tables of a device.
+ *
+ * Provides the register callbacks for the tables in the profile. They
+ * can be used as the register map of MB::MBSlave.
+ */
+template< class... Tables >
+struct MBProfile
+{
+    using           Holding = typename Detail::MBProfileFind< MB_REG_MAP_HOLDING, Tables... >::type;
+    using           Input = typename Detail::MBProfileFind< MB_REG_MAP_INPUT, Tables... >::type;
+    using           Coils = typename Detail::MBProfileFind< MB_REG_MAP_COILS, Tables... >::type;
+    using           Discrete = typename Detail::MBProfileFind< MB_REG_MAP_DISCRETE, Tables... >::type;
+
+    static_assert( ( sizeof...( Tables ) >= 1 ) &&
+                   ( sizeof...( Tables ) == ( !std::is_void_v< Holding > ) + ( !std::is_void_v< Input > ) +
+                     ( !std::is_void_v< Coils > ) + ( !std::is_void_v< Discrete > ) ),
+                   "a profile needs one to four different tables" );
+
+    static eMBErrorCode eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+        requires( !std::is_void_v< Input > )
+    {
+        return Input::eMBProfileRegs( pucRegBuffer, usAddress, usNRegs, MB_REG_READ );
+    }
+
+    static eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                         USHORT usNRegs, eMBRegisterMode eMode )
+        requires( !std::is_void_v< Holding > )
+    {
+        return Holding::eMBProfileRegs( pucRegBuffer, usAddress, usNRegs, eMode );
+    }
+
+    static eMBErrorCode eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                       USHORT usNCoils, eMBRegisterMode eMode )
+        requires( !std::is_void_v< Coils > )
+    {
+        return Coils::eMBProfileBits( pucRegBuffer, usAddress, usNCoils, eMode );
+    }
+
+    static eMBErrorCode eMBRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete )
+        requires( !std::is_void_v< Discrete > )
+    {
+        return Discrete::eMBProfileBits( pucRegBuffer, usAddress, usNDiscrete, MB_REG_READ );
+    }
+};
+
+namespace Detail
+{
+/* Used by MB_PROFILE_CALLBACKS( ). Tables which are not in the profile
+ * have no registers. */
+template< class P >
+eMBErrorCode
+eMBProfileInput( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+{
+    eMBErrorCode    eStatus = MB_ENOREG;
+
+    if constexpr( !std::is_void_v< typename P::Input > )
+    {
+        eStatus = P::eMBRegInputCB( pucRegBuffer, usAddress, usNRegs );
+    }
+    return eStatus;
+}
+
+template< class P >
+eMBErrorCode
+eMBProfileHolding( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOREG;
+
+    if constexpr( !std::is_void_v< typename P::Holding > )
+    {
+        eStatus = P::eMBRegHoldingCB( pucRegBuffer, usAddress, usNRegs, eMode );
+    }
+    return eStatus;
+}
+
+template< class P >
+eMBErrorCode
+eMBProfileCoils( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNCoils, eMBRegisterMode eMode )
+{
+    eMBErrorCode    eStatus = MB_ENOREG;
+
+    if constexpr( !std::is_void_v< typename P::Coils > )
+    {
+        eStatus = P::eMBRegCoilsCB( pucRegBuffer, usAddress, usNCoils, eMode );
+    }
+    return eStatus;
+}
+
+template< class P >
+eMBErrorCode
+eMBProfileDiscrete( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete )
+{
+    eMBErrorCode    eStatus = MB_ENOREG;
+
+    if constexpr( !std::is_void_v< typename P::Discrete > )
+    {
+        eStatus = P::eMBRegDiscreteCB( pucRegBuffer, usAddress, usNDiscrete );
+    }
+    return eStatus;
+}
+}
+}
+
+/*! \brief Defines the C register callbacks for eMBPoll( ) with a profile.
+ *
+ * Must be used once at namespace scope in a C++ file.
+ */
+#define MB_PROFILE_CALLBACKS( Profile ) \
+    extern "C" eMBErrorCode \
+    eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs ) \
+    { \
+        return MB::Detail::eMBProfileInput< Profile >( pucRegBuffer, usAddress, usNRegs ); \
+    } \
+    extern "C" eMBErrorCode \
+    eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode ) \
+    { \
+        return MB::Detail::eMBProfileHolding< Profile >( pucRegBuffer, usAddress, usNRegs, eMode ); \
+    } \
+    extern "C" eMBErrorCode \
+    eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNCoils, eMBRegisterMode eMode ) \
+    { \
+        return MB::Detail::eMBProfileCoils< Profile >( pucRegBuffer, usAddress, usNCoils, eMode ); \
+    } \
+    extern "C" eMBErrorCode \
+    eMBRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete ) \
+    { \
+        return MB::Detail::eMBProfileDiscrete< Profile >( pucRegBuffer, usAddress, usNDiscrete ); \
+    }
+
+/*! @} */
+#endif
@@ -54,6 +54,9 @@ PR_BEGIN_EXTERN_C
 #define MB_FUNC_OTHER_REPORT_SLAVEID          ( 17 )
 #define MB_FUNC_READ_FILE_RECORD              ( 20 )
 #define MB_FUNC_WRITE_FILE_RECORD             ( 21 )
+#define MB_FUNC_MASK_WRITE_REGISTER           ( 22 )
+#define MB_FUNC_READ_FIFO_QUEUE               ( 24 )
+#define MB_FUNC_OTHER_ENCAP_INTERFACE         ( 43 )
 #define MB_FUNC_ERROR                         ( 128 )
 /* ----------------------- Type definitions ---------------------------------*/
     typedef enum
@@ -65,9 +68,11 @@ PR_BEGIN_EXTERN_C
     MB_EX_SLAVE_DEVICE_FAILURE = 0x04,
     MB_EX_ACKNOWLEDGE = 0x05,
     MB_EX_SLAVE_BUSY = 0x06,
+    MB_EX_NEGATIVE_ACKNOWLEDGE = 0x07,
     MB_EX_MEMORY_PARITY_ERROR = 0x08,
     MB_EX_GATEWAY_PATH_FAILED = 0x0A,
-    MB_EX_GATEWAY_TGT_FAILED = 0x0B
+    MB_EX_GATEWAY_TGT_FAILED = 0x0B,
+    MB_EX_PENDING = 0xFF        /* Internal: the response is sent later. */
 } eMBException;
 
 typedef         eMBException( *pxMBFunctionHandler ) ( UCHAR * pucFrame, USHORT * pusLength );
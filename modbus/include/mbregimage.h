@@ -0,0 +1,146 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_REGIMAGE_H
+#define _MB_REGIMAGE_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_regimage Register Images
+ * \code #include "mbregimage.h" \endcode
+ *
+ * A register image shares an array of registers between application threads
+ * and the task calling eMBPoll( ). It is protected by a sequence lock.
+ * Writers increment the sequence number before and after they change the
+ * registers. Readers copy the registers and retry if the sequence number
+ * was odd or has changed in between. Readers therefore never block a
+ * writer and always see a consistent snapshot, e.g. both halves of a 32 bit
+ * value. Writers are serialized by a spin lock. The critical section of
+ * the port is only used if the compiler has no atomic builtins.
+ *
+ * An image is bound to a holding or input register range by setting the
+ * flag MB_REG_MAP_IMAGE in the range and passing the image as its data.
+ * Requests which span several ranges are consistent within each range.
+ *
+ * \code
+ * static USHORT   usValues[32];
+ * static xMBRegImage xValues;
+ *
+ * static const xMBRegMapRange xInput[] = {
+ *     { 1, 32, MB_REG_MAP_READ | MB_REG_MAP_IMAGE, &xValues }
+ * };
+ *
+ * eMBRegImageInit( &xValues, usValues, 32 );
+ * eMBRegMapSet( MB_REG_MAP_INPUT, xInput, 1 );
+ * ...
+ * // In an application thread.
+ * vMBRegImageBeginWrite( &xValues );
+ * usValues[0] = ( USHORT )( ulCounter >> 16 );
+ * usValues[1] = ( USHORT )( ulCounter & 0xFFFF );
+ * vMBRegImageEndWrite( &xValues );
+ * \endcode
+ */
+/*! \addtogroup modbus_regimage
+ *  @{
+ */
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief A register image. The members are private to the protocol stack. */
+typedef struct
+{
+    volatile ULONG  ulSequence;     /*!< Odd while a writer is active. */
+    volatile ULONG  ulLock;         /*!< Serializes the writers. */
+    USHORT         *pusRegs;        /*!< The registers. */
+    USHORT          usNRegs;        /*!< Number of registers. */
+} xMBRegImage;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Initialize a register image.
+ *
+ * \param pxImage The image.
+ * \param pusRegs Storage for the registers. The current values are kept.
+ * \param usNRegs Number of registers.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the arguments are invalid. Otherwise
+ *   eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBRegImageInit( xMBRegImage * pxImage, USHORT * pusRegs, USHORT usNRegs );
+
+/*! \brief Start an update of the registers.
+ *
+ * Between this call and vMBRegImageEndWrite( ) the caller can modify the
+ * registers directly. The update should be short because readers spin
+ * until it is done.
+ */
+void            vMBRegImageBeginWrite( xMBRegImage * pxImage );
+
+/*! \brief Publish the registers changed since vMBRegImageBeginWrite( ). */
+void            vMBRegImageEndWrite( xMBRegImage * pxImage );
+
+/*! \brief Change registers of an image.
+ *
+ * \param pxImage The image.
+ * \param usOffset Index of the first register.
+ * \param pusValues The new values.
+ * \param usNRegs Number of registers.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the registers are outside of the image.
+ *   Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBRegImageWrite( xMBRegImage * pxImage, USHORT usOffset,
+                                  const USHORT * pusValues, USHORT usNRegs );
+
+/*! \brief Read a consistent snapshot of registers.
+ *
+ * \param pxImage The image.
+ * \param usOffset Index of the first register.
+ * \param pusValues Buffer for the values.
+ * \param usNRegs Number of registers.
+ *
+ * \return eMBErrorCode::MB_EINVAL if the registers are outside of the image.
+ *   eMBErrorCode::MB_ETIMEDOUT if no snapshot could be taken within
+ *   MB_REG_IMAGE_READ_RETRIES attempts. Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBRegImageRead( xMBRegImage * pxImage, USHORT usOffset,
+                                 USHORT * pusValues, USHORT usNRegs );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+eMBErrorCode    eMBRegImageAccess( xMBRegImage * pxImage, UCHAR * pucRegBuffer,
+                                   USHORT usOffset, USHORT usNRegs,
+                                   eMBRegisterMode eMode );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -0,0 +1,163 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_REGMAP_H
+#define _MB_REGMAP_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_regmap Register Map
+ * \code #include "mbregmap.h" \endcode
+ *
+ * If MB_REG_MAP_ENABLED is set to <code>1</code> the application can bind
+ * address ranges directly to variables with eMBRegMapSet( ). The function
+ * handlers then copy the values between the PDU and the variables without
+ * calling the register callbacks. Registers are stored as native
+ * <code>USHORT</code> arrays. Coils and discrete inputs are stored as
+ * bitsets where the first bit is the LSB of the first byte. As for
+ * xMBUtilSetBits( ) the size of a bitset must be a multiple of two bytes.
+ *
+ * The ranges of a table must be sorted by their address and must not
+ * overlap. A range is found with a binary search, so the cost of a request
+ * grows only logarithmically with the number of ranges. A request may span
+ * several adjacent ranges. Ranges flagged with
+ * MB_REG_MAP_DYNAMIC are served by the callback of the table, e.g.
+ * eMBRegHoldingCB( ), with the part of the request which falls into the
+ * range. If no map is set for a table all requests for this table are
+ * passed to its callback.
+ *
+ * \code
+ * static USHORT   usSetpoints[16];
+ * static USHORT   usStatus[4];
+ *
+ * static const xMBRegMapRange xHolding[] = {
+ *     { 1000, 16, MB_REG_MAP_READ | MB_REG_MAP_WRITE, usSetpoints },
+ *     { 1016, 4, MB_REG_MAP_READ, usStatus },
+ *     { 2000, 100, MB_REG_MAP_READ | MB_REG_MAP_WRITE | MB_REG_MAP_DYNAMIC, NULL }
+ * };
+ *
+ * eMBRegMapSet( MB_REG_MAP_HOLDING, xHolding, 3 );
+ * \endcode
+ */
+/*! \addtogroup modbus_regmap
+ *  @{
+ */
+/* ----------------------- Defines ------------------------------------------*/
+/*! \brief The range can be read by the master. */
+#define MB_REG_MAP_READ             ( 0x01 )
+/*! \brief The range can be written by the master. */
+#define MB_REG_MAP_WRITE            ( 0x02 )
+/*! \brief The range is served by the callback of the table. */
+#define MB_REG_MAP_DYNAMIC          ( 0x04 )
+/*! \brief The data of the range is a register image. See mbregimage.h. */
+#define MB_REG_MAP_IMAGE            ( 0x08 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief The register tables which can be mapped. */
+typedef enum
+{
+    MB_REG_MAP_HOLDING,         /*!< Holding registers. */
+    MB_REG_MAP_INPUT,           /*!< Input registers. */
+    MB_REG_MAP_COILS,           /*!< Coils. */
+    MB_REG_MAP_DISCRETE,        /*!< Discrete inputs. */
+    MB_REG_MAP_TABLES
+} eMBRegMapTable;
+
+/*! \brief An address range bound to a variable. */
+typedef struct
+{
+    USHORT          usAddress;  /*!< First address as passed to the callbacks. */
+    USHORT          usNRegs;    /*!< Number of registers or bits. */
+    UCHAR           ucFlags;    /*!< MB_REG_MAP_READ, ... */
+    void           *pvData;     /*!< A USHORT array, a bitset or an xMBRegImage. */
+} xMBRegMapRange;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Set the map for a register table.
+ *
+ * The ranges are not copied and can be placed in read only memory. Must
+ * be called before the protocol stack is enabled.
+ *
+ * \param eTable The table.
+ * \param pxRanges The ranges or \c NULL to remove the map.
+ * \param usNRanges Number of ranges.
+ *
+ * \return eMBErrorCode::MB_EINVAL if a range is empty, exceeds the address
+ *   space, has no data or if the ranges are not sorted and disjoint.
+ *   Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBRegMapSet( eMBRegMapTable eTable,
+                              const xMBRegMapRange * pxRanges,
+                              USHORT usNRanges );
+
+/*! @} */
+
+/* ----------------------- Internal functions -------------------------------*/
+/* If the callbacks of a table are used by any of the enabled functions. */
+#define MB_REG_MAP_HOLDING_USED \
+    ( ( MB_FUNC_READ_HOLDING_ENABLED > 0 ) || ( MB_FUNC_WRITE_HOLDING_ENABLED > 0 ) || \
+      ( MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED > 0 ) || ( MB_FUNC_READWRITE_HOLDING_ENABLED > 0 ) || \
+      ( MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0 ) )
+#define MB_REG_MAP_INPUT_USED \
+    ( MB_FUNC_READ_INPUT_ENABLED > 0 )
+#define MB_REG_MAP_COILS_USED \
+    ( ( MB_FUNC_READ_COILS_ENABLED > 0 ) || ( MB_FUNC_WRITE_COIL_ENABLED > 0 ) || \
+      ( MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0 ) )
+#define MB_REG_MAP_DISCRETE_USED \
+    ( MB_FUNC_READ_DISCRETE_INPUTS_ENABLED > 0 )
+
+#if MB_REG_MAP_ENABLED > 0
+eMBErrorCode    eMBRegMapHolding( UCHAR * pucRegBuffer, USHORT usAddress,
+                                  USHORT usNRegs, eMBRegisterMode eMode );
+eMBErrorCode    eMBRegMapInput( UCHAR * pucRegBuffer, USHORT usAddress,
+                                USHORT usNRegs );
+eMBErrorCode    eMBRegMapCoils( UCHAR * pucRegBuffer, USHORT usAddress,
+                                USHORT usNCoils, eMBRegisterMode eMode );
+eMBErrorCode    eMBRegMapDiscrete( UCHAR * pucRegBuffer, USHORT usAddress,
+                                   USHORT usNDiscrete );
+
+#define MB_REG_HOLDING_CB           eMBRegMapHolding
+#define MB_REG_INPUT_CB             eMBRegMapInput
+#define MB_REG_COILS_CB             eMBRegMapCoils
+#define MB_REG_DISCRETE_CB          eMBRegMapDiscrete
+#else
+#define MB_REG_HOLDING_CB           eMBRegHoldingCB
+#define MB_REG_INPUT_CB             eMBRegInputCB
+#define MB_REG_COILS_CB             eMBRegCoilsCB
+#define MB_REG_DISCRETE_CB          eMBRegDiscreteCB
+#endif
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -0,0 +1,902 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_STACK_HPP
+#define _MB_STACK_HPP
+
+#include <concepts>
+
+#include "port.h"
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbfunc.h"
+#include "mbregmap.h"
+#include "mbhooks.h"
+#include "mbcrc.h"
+
+/*! \defgroup modbus_stack C++ Stack
+ * \code #include "mbstack.hpp" \endcode
+ *
+ * This header only C++20 front-end builds a Modbus slave from three
+ * template parameters. The transport (MB::MBRtu, MB::MBAscii or MB::MBTcp)
+ * selects the framing and the checksum, the port moves complete frames and
+ * the register map provides the register callbacks. The function handlers
+ * are selected at compile time: a function code is supported if it is
+ * enabled in mbconfig.h and the register map has the callback it needs.
+ * All other function codes are answered with an <b>ILLEGAL FUNCTION</b>
+ * exception. Nothing is dispatched through function pointers and unused
+ * handlers are not linked.
+ *
+ * The frames on the wire are the same as those of the C stack. The limits
+ * of the handlers are those of the C handlers and usMBCRC16( ) is used for
+ * the checksum of the RTU frames. The handlers for report slave id and
+ * read device identification are the C handlers. Writes are reported to
+ * the journal. The subscriptions read through the C callbacks and not
+ * through the register map, and the cache is never looked up by this
+ * front-end. Both are therefore not used here. The subscriptions, the
+ * cache, the statistics, the diagnostic counters, deferred requests and
+ * the executor are only available with eMBPoll( ).
+ *
+ * The port is a class with two static functions:
+ *  - <tt>BOOL xMBPortFrameReceive( UCHAR * pucADU, USHORT usSize, USHORT * pusLength )</tt>
+ *    copies a received frame into \c pucADU and returns \c TRUE. It returns
+ *    \c FALSE if no frame is available. RTU frames are delimited by the
+ *    port, for example with an idle line interrupt. ASCII frames start at
+ *    the last ':' and end with the LF character. TCP frames start with the
+ *    MBAP header.
+ *  - <tt>BOOL xMBPortFrameSend( const UCHAR * pucADU, USHORT usLength )</tt>
+ *    sends a frame and returns \c FALSE if this is not possible.
+ *
+ * The register map is a class with one or more of the static functions
+ * eMBRegInputCB( ), eMBRegHoldingCB( ), eMBRegCoilsCB( ),
+ * eMBRegDiscreteCB( ) and eMBRegHoldingMaskCB( ). They have the same
+ * arguments as the C callbacks. MB::MBRegCallbacks uses the callbacks of
+ * the C stack. Without eMBRegHoldingMaskCB( ) the <em>Mask Write
+ * Register</em> function reads and writes the register with two calls of
+ * eMBRegHoldingCB( ) which is not atomic.
+ *
+ * \code
+ * struct xSensorRegs
+ * {
+ *     static eMBErrorCode
+ *     eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs );
+ * };
+ *
+ * static MB::MBSlave< MB::MBRtu, xUartPort, xSensorRegs > xSlave( 0x0A );
+ *
+ * for( ;; )
+ * {
+ *     ( void )xSlave.eMBPoll(  );
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_stack
+ *  @{
+ */
+namespace MB
+{
+/* ----------------------- Register maps ------------------------------------*/
+/*! \brief Register map which calls the callbacks of the C stack. */
+struct MBRegCallbacks
+{
+    static eMBErrorCode eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+    {
+        return ::MB_REG_INPUT_CB( pucRegBuffer, usAddress, usNRegs );
+    }
+
+    static eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                         USHORT usNRegs, eMBRegisterMode eMode )
+    {
+        return ::MB_REG_HOLDING_CB( pucRegBuffer, usAddress, usNRegs, eMode );
+    }
+
+    static eMBErrorCode eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                       USHORT usNCoils, eMBRegisterMode eMode )
+    {
+        return ::MB_REG_COILS_CB( pucRegBuffer, usAddress, usNCoils, eMode );
+    }
+
+    static eMBErrorCode eMBRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                          USHORT usNDiscrete )
+    {
+        return ::MB_REG_DISCRETE_CB( pucRegBuffer, usAddress, usNDiscrete );
+    }
+
+#if MB_FUNC_MASK_WRITE_HOLDING_CB_ENABLED > 0
+    static eMBErrorCode eMBRegHoldingMaskCB( USHORT usAddress, USHORT usAndMask, USHORT usOrMask )
+    {
+        return ::eMBRegHoldingMaskCB( usAddress, usAndMask, usOrMask );
+    }
+#endif
+};
+
+namespace Detail
+{
+/* ----------------------- Register map concepts ----------------------------*/
+template< class R >
+concept MBHasInput = requires( UCHAR * pucRegBuffer, USHORT usValue )
+{
+    { R::eMBRegInputCB( pucRegBuffer, usValue, usValue ) } -> std::same_as< eMBErrorCode >;
+};
+
+template< class R >
+concept MBHasHolding = requires( UCHAR * pucRegBuffer, USHORT usValue )
+{
+    { R::eMBRegHoldingCB( pucRegBuffer, usValue, usValue, MB_REG_READ ) } -> std::same_as< eMBErrorCode >;
+};
+
+template< class R >
+concept MBHasHoldingMask = requires( USHORT usValue )
+{
+    { R::eMBRegHoldingMaskCB( usValue, usValue, usValue ) } -> std::same_as< eMBErrorCode >;
+};
+
+template< class R >
+concept MBHasCoils = requires( UCHAR * pucRegBuffer, USHORT usValue )
+{
+    { R::eMBRegCoilsCB( pucRegBuffer, usValue, usValue, MB_REG_READ ) } -> std::same_as< eMBErrorCode >;
+};
+
+template< class R >
+concept MBHasDiscrete = requires( UCHAR * pucRegBuffer, USHORT usValue )
+{
+    { R::eMBRegDiscreteCB( pucRegBuffer, usValue, usValue ) } -> std::same_as< eMBErrorCode >;
+};
+
+/* ----------------------- PDU layout ---------------------------------------*/
+constexpr USHORT usMBPDUAddrOff = MB_PDU_DATA_OFF;
+constexpr USHORT usMBPDUCntOff = MB_PDU_DATA_OFF + 2;
+constexpr USHORT usMBPDUValueOff = MB_PDU_DATA_OFF + 2;
+constexpr USHORT usMBPDUMulByteCntOff = MB_PDU_DATA_OFF + 4;
+constexpr USHORT usMBPDUMulValuesOff = MB_PDU_DATA_OFF + 5;
+constexpr USHORT usMBPDUReadSize = 4;
+constexpr USHORT usMBPDUWriteSize = 4;
+constexpr USHORT usMBPDUWriteMulSizeMin = 5;
+constexpr USHORT usMBPDUMaskWriteSize = 6;
+constexpr USHORT usMBPDUReadWriteSizeMin = 9;
+
+/* ----------------------- Helpers ------------------------------------------*/
+constexpr USHORT
+usMBGetU16( const UCHAR * pucBuf )
+{
+    return ( USHORT )( ( pucBuf[0] << 8 ) | pucBuf[1] );
+}
+
+constexpr UCHAR
+ucMBBitsToBytes( USHORT usNBits )
+{
+    return ( UCHAR )( ( ( usNBits & 0x0007 ) != 0 ) ? ( usNBits / 8 + 1 ) : ( usNBits / 8 ) );
+}
+
+/* Same mapping as prveMBError2Exception( ). The callbacks can not defer
+ * a request here. */
+constexpr eMBException
+eMBError2Exception( eMBErrorCode eErrorCode )
+{
+    eMBException    eStatus;
+
+    switch ( eErrorCode )
+    {
+    case MB_ENOERR:
+        eStatus = MB_EX_NONE;
+        break;
+
+    case MB_ENOREG:
+        eStatus = MB_EX_ILLEGAL_DATA_ADDRESS;
+        break;
+
+    case MB_ETIMEDOUT:
+        eStatus = MB_EX_SLAVE_BUSY;
+        break;
+
+    default:
+        eStatus = MB_EX_SLAVE_DEVICE_FAILURE;
+        break;
+    }
+    return eStatus;
+}
+
+/* ----------------------- Function handlers --------------------------------*/
+/* The handlers check the requests like the C handlers in modbus/functions.
+ * Coils and discrete inputs accept less than usCntLimit values, input
+ * registers less than 0x7D and holding registers up to 0x7D. */
+template< typename Read >
+eMBException
+eMBFuncReadValues( UCHAR * pucFrame, USHORT * usLen, USHORT usCntLimit, UCHAR ucNBytes1, Read xRead )
+{
+    USHORT          usRegAddress;
+    USHORT          usCount;
+    UCHAR           ucNBytes;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen == ( usMBPDUReadSize + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+        usCount = usMBGetU16( &pucFrame[usMBPDUCntOff] );
+
+        if( ( usCount >= 1 ) && ( usCount < usCntLimit ) )
+        {
+            ucNBytes = ( ucNBytes1 == 0 ) ? ucMBBitsToBytes( usCount ) : ( UCHAR )( usCount * ucNBytes1 );
+            pucFrame[MB_PDU_DATA_OFF] = ucNBytes;
+            eRegStatus = xRead( &pucFrame[MB_PDU_DATA_OFF + 1], usRegAddress, usCount );
+            if( eRegStatus != MB_ENOERR )
+            {
+                eStatus = eMBError2Exception( eRegStatus );
+            }
+            else
+            {
+                *usLen = ( USHORT )( MB_PDU_DATA_OFF + 1 + ucNBytes );
+            }
+        }
+        else
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncReadInputRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    return eMBFuncReadValues( pucFrame, usLen, 0x007D, 2,[]( UCHAR * pucBuf, USHORT usAddress, USHORT usNRegs )
+                              {
+                                  return R::eMBRegInputCB( pucBuf, usAddress, usNRegs );
+                              } );
+}
+
+template< class R >
+eMBException
+eMBFuncReadHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    return eMBFuncReadValues( pucFrame, usLen, 0x007D + 1, 2,[]( UCHAR * pucBuf, USHORT usAddress, USHORT usNRegs )
+                              {
+                                  return R::eMBRegHoldingCB( pucBuf, usAddress, usNRegs, MB_REG_READ );
+                              } );
+}
+
+template< class R >
+eMBException
+eMBFuncReadCoils( UCHAR * pucFrame, USHORT * usLen )
+{
+    return eMBFuncReadValues( pucFrame, usLen, 0x07D0, 0,[]( UCHAR * pucBuf, USHORT usAddress, USHORT usNCoils )
+                              {
+                                  return R::eMBRegCoilsCB( pucBuf, usAddress, usNCoils, MB_REG_READ );
+                              } );
+}
+
+template< class R >
+eMBException
+eMBFuncReadDiscreteInputs( UCHAR * pucFrame, USHORT * usLen )
+{
+    return eMBFuncReadValues( pucFrame, usLen, 0x07D0, 0,[]( UCHAR * pucBuf, USHORT usAddress, USHORT usNDiscrete )
+                              {
+                                  return R::eMBRegDiscreteCB( pucBuf, usAddress, usNDiscrete );
+                              } );
+}
+
+template< class R >
+eMBException
+eMBFuncWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen == ( usMBPDUWriteSize + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+        eRegStatus = R::eMBRegHoldingCB( &pucFrame[usMBPDUValueOff], usRegAddress, 1, MB_REG_WRITE );
+        if( eRegStatus != MB_ENOERR )
+        {
+            eStatus = eMBError2Exception( eRegStatus );
+        }
+        else
+        {
+            MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_HOLDING, usRegAddress, 1 );
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    USHORT          usRegCount;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen >= ( usMBPDUWriteMulSizeMin + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+        usRegCount = usMBGetU16( &pucFrame[usMBPDUCntOff] );
+
+        if( ( usRegCount >= 1 ) && ( usRegCount <= 0x0078 ) &&
+            ( pucFrame[usMBPDUMulByteCntOff] == ( UCHAR )( 2 * usRegCount ) ) )
+        {
+            eRegStatus = R::eMBRegHoldingCB( &pucFrame[usMBPDUMulValuesOff], usRegAddress, usRegCount, MB_REG_WRITE );
+            if( eRegStatus != MB_ENOERR )
+            {
+                eStatus = eMBError2Exception( eRegStatus );
+            }
+            else
+            {
+                MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_HOLDING, usRegAddress, usRegCount );
+                *usLen = usMBPDUMulByteCntOff;
+            }
+        }
+        else
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncMaskWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    USHORT          usAndMask;
+    USHORT          usOrMask;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen == ( usMBPDUMaskWriteSize + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+        usAndMask = usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 2] );
+        usOrMask = usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 4] );
+
+        if constexpr( MBHasHoldingMask< R > )
+        {
+            eRegStatus = R::eMBRegHoldingMaskCB( usRegAddress, usAndMask, usOrMask );
+        }
+        else
+        {
+            USHORT          usRegValue;
+            UCHAR           ucRegBuffer[2];
+
+            /* The callbacks may block or lock themselves and are not called
+             * within a critical section. Register maps which need an atomic
+             * update must provide eMBRegHoldingMaskCB( ). */
+            eRegStatus = R::eMBRegHoldingCB( ucRegBuffer, usRegAddress, 1, MB_REG_READ );
+            if( eRegStatus == MB_ENOERR )
+            {
+                usRegValue = usMBGetU16( ucRegBuffer );
+                usRegValue = ( USHORT )( ( usRegValue & usAndMask ) | ( usOrMask & ~usAndMask ) );
+                ucRegBuffer[0] = ( UCHAR )( usRegValue >> 8 );
+                ucRegBuffer[1] = ( UCHAR )( usRegValue & 0xFF );
+                eRegStatus = R::eMBRegHoldingCB( ucRegBuffer, usRegAddress, 1, MB_REG_WRITE );
+            }
+        }
+
+        if( eRegStatus != MB_ENOERR )
+        {
+            eStatus = eMBError2Exception( eRegStatus );
+        }
+        else
+        {
+            MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_HOLDING, usRegAddress, 1 );
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncReadWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegReadAddress;
+    USHORT          usRegReadCount;
+    USHORT          usRegWriteAddress;
+    USHORT          usRegWriteCount;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen >= ( usMBPDUReadWriteSizeMin + MB_PDU_SIZE_MIN ) )
+    {
+        usRegReadAddress = ( USHORT )( usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 0] ) + 1 );
+        usRegReadCount = usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 2] );
+        usRegWriteAddress = ( USHORT )( usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 4] ) + 1 );
+        usRegWriteCount = usMBGetU16( &pucFrame[MB_PDU_DATA_OFF + 6] );
+
+        if( ( usRegReadCount >= 1 ) && ( usRegReadCount <= 0x7D ) &&
+            ( usRegWriteCount >= 1 ) && ( usRegWriteCount <= 0x79 ) &&
+            ( ( 2 * usRegWriteCount ) == pucFrame[MB_PDU_DATA_OFF + 8] ) )
+        {
+            eRegStatus = R::eMBRegHoldingCB( &pucFrame[MB_PDU_DATA_OFF + 9],
+                                             usRegWriteAddress, usRegWriteCount, MB_REG_WRITE );
+            if( eRegStatus == MB_ENOERR )
+            {
+                MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_HOLDING, usRegWriteAddress, usRegWriteCount );
+
+                pucFrame[MB_PDU_DATA_OFF] = ( UCHAR )( usRegReadCount * 2 );
+                *usLen = MB_PDU_DATA_OFF + 1;
+                eRegStatus = R::eMBRegHoldingCB( &pucFrame[MB_PDU_DATA_OFF + 1],
+                                                 usRegReadAddress, usRegReadCount, MB_REG_READ );
+                if( eRegStatus == MB_ENOERR )
+                {
+                    *usLen += ( USHORT )( 2 * usRegReadCount );
+                }
+            }
+            if( eRegStatus != MB_ENOERR )
+            {
+                eStatus = eMBError2Exception( eRegStatus );
+            }
+        }
+        else
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncWriteCoil( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    UCHAR           ucBuf[2];
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen == ( usMBPDUWriteSize + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+
+        if( ( pucFrame[usMBPDUValueOff + 1] == 0x00 ) &&
+            ( ( pucFrame[usMBPDUValueOff] == 0xFF ) || ( pucFrame[usMBPDUValueOff] == 0x00 ) ) )
+        {
+            ucBuf[0] = ( pucFrame[usMBPDUValueOff] == 0xFF ) ? 1 : 0;
+            ucBuf[1] = 0;
+            eRegStatus = R::eMBRegCoilsCB( &ucBuf[0], usRegAddress, 1, MB_REG_WRITE );
+            if( eRegStatus != MB_ENOERR )
+            {
+                eStatus = eMBError2Exception( eRegStatus );
+            }
+            else
+            {
+                MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_COILS, usRegAddress, 1 );
+            }
+        }
+        else
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+template< class R >
+eMBException
+eMBFuncWriteMultipleCoils( UCHAR * pucFrame, USHORT * usLen )
+{
+    USHORT          usRegAddress;
+    USHORT          usCoilCnt;
+    eMBException    eStatus = MB_EX_NONE;
+    eMBErrorCode    eRegStatus;
+
+    if( *usLen > ( usMBPDUWriteSize + MB_PDU_SIZE_MIN ) )
+    {
+        usRegAddress = ( USHORT )( usMBGetU16( &pucFrame[usMBPDUAddrOff] ) + 1 );
+        usCoilCnt = usMBGetU16( &pucFrame[usMBPDUCntOff] );
+
+        if( ( usCoilCnt >= 1 ) && ( usCoilCnt <= 0x07B0 ) &&
+            ( ucMBBitsToBytes( usCoilCnt ) == pucFrame[usMBPDUMulByteCntOff] ) )
+        {
+            eRegStatus = R::eMBRegCoilsCB( &pucFrame[usMBPDUMulValuesOff], usRegAddress, usCoilCnt, MB_REG_WRITE );
+            if( eRegStatus != MB_ENOERR )
+            {
+                eStatus = eMBError2Exception( eRegStatus );
+            }
+            else
+            {
+                MB_HOOK_WRITE_JOURNAL( MB_REG_MAP_COILS, usRegAddress, usCoilCnt );
+                *usLen = usMBPDUMulByteCntOff;
+            }
+        }
+        else
+        {
+            eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+        }
+    }
+    else
+    {
+        eStatus = MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    return eStatus;
+}
+
+/* ----------------------- Dispatch -----------------------------------------*/
+/* Resolved at compile time. Function codes without a handler produce an
+ * ILLEGAL FUNCTION exception like in eMBPoll( ). */
+template< class R >
+eMBException
+eMBExecute( UCHAR * pucFrame, USHORT * usLen )
+{
+    eMBException    eException = MB_EX_ILLEGAL_FUNCTION;
+
+    switch ( pucFrame[MB_PDU_FUNC_OFF] )
+    {
+#if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
+    case MB_FUNC_OTHER_REPORT_SLAVEID:
+        eException = ::eMBFuncReportSlaveID( pucFrame, usLen );
+        break;
+#endif
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+    case MB_FUNC_OTHER_ENCAP_INTERFACE:
+        eException = ::eMBFuncEncapInterface( pucFrame, usLen );
+        break;
+#endif
+    case MB_FUNC_READ_INPUT_REGISTER:
+        if constexpr( ( MB_FUNC_READ_INPUT_ENABLED > 0 ) && MBHasInput< R > )
+        {
+            eException = eMBFuncReadInputRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_READ_HOLDING_REGISTER:
+        if constexpr( ( MB_FUNC_READ_HOLDING_ENABLED > 0 ) && MBHasHolding< R > )
+        {
+            eException = eMBFuncReadHoldingRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_WRITE_MULTIPLE_REGISTERS:
+        if constexpr( ( MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED > 0 ) && MBHasHolding< R > )
+        {
+            eException = eMBFuncWriteMultipleHoldingRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_WRITE_REGISTER:
+        if constexpr( ( MB_FUNC_WRITE_HOLDING_ENABLED > 0 ) && MBHasHolding< R > )
+        {
+            eException = eMBFuncWriteHoldingRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_MASK_WRITE_REGISTER:
+        if constexpr( ( MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0 ) && MBHasHolding< R > )
+        {
+            eException = eMBFuncMaskWriteHoldingRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_READWRITE_MULTIPLE_REGISTERS:
+        if constexpr( ( MB_FUNC_READWRITE_HOLDING_ENABLED > 0 ) && MBHasHolding< R > )
+        {
+            eException = eMBFuncReadWriteMultipleHoldingRegister< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_READ_COILS:
+        if constexpr( ( MB_FUNC_READ_COILS_ENABLED > 0 ) && MBHasCoils< R > )
+        {
+            eException = eMBFuncReadCoils< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_WRITE_SINGLE_COIL:
+        if constexpr( ( MB_FUNC_WRITE_COIL_ENABLED > 0 ) && MBHasCoils< R > )
+        {
+            eException = eMBFuncWriteCoil< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_WRITE_MULTIPLE_COILS:
+        if constexpr( ( MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0 ) && MBHasCoils< R > )
+        {
+            eException = eMBFuncWriteMultipleCoils< R >( pucFrame, usLen );
+        }
+        break;
+
+    case MB_FUNC_READ_DISCRETE_INPUTS:
+        if constexpr( ( MB_FUNC_READ_DISCRETE_INPUTS_ENABLED > 0 ) && MBHasDiscrete< R > )
+        {
+            eException = eMBFuncReadDiscreteInputs< R >( pucFrame, usLen );
+        }
+        break;
+
+    default:
+        break;
+    }
+    return eException;
+}
+}
+
+/* ----------------------- Transports ---------------------------------------*/
+/*! \brief Modbus RTU framing: address, PDU and CRC16. */
+struct MBRtu
+{
+    /*! \brief Size of the frame buffer. */
+    static constexpr USHORT usBufferSize = 256;
+    /*! \brief Offset of the PDU in the frame buffer. */
+    static constexpr USHORT usPDUOff = 1;
+    /*! \brief Frames carry a slave address which must match. */
+    static constexpr bool xAddressed = true;
+
+    /*! \brief Checks a received frame and returns the address and the PDU length. */
+    static BOOL     xDecode( UCHAR * pucADU, USHORT usLength, UCHAR * pucAddress, USHORT * pusPDULength )
+    {
+        BOOL            xValid = FALSE;
+
+        if( ( usLength >= 4 ) && ( usLength <= usBufferSize ) && ( usMBCRC16( pucADU, usLength ) == 0 ) )
+        {
+            *pucAddress = pucADU[0];
+            *pusPDULength = ( USHORT )( usLength - 1 - 2 );
+            xValid = TRUE;
+        }
+        return xValid;
+    }
+
+    /*! \brief Adds the address and the checksum and returns the frame length. */
+    static USHORT   usEncode( UCHAR * pucADU, UCHAR ucAddress, USHORT usPDULength )
+    {
+        USHORT          usLength = ( USHORT )( 1 + usPDULength );
+        USHORT          usCRC16;
+
+        pucADU[0] = ucAddress;
+        usCRC16 = usMBCRC16( pucADU, usLength );
+        pucADU[usLength++] = ( UCHAR )( usCRC16 & 0xFF );
+        pucADU[usLength++] = ( UCHAR )( usCRC16 >> 8 );
+        return usLength;
+    }
+};
+
+/*! \brief Modbus ASCII framing: ':', address, PDU and LRC as hex characters, CR and LF. */
+struct MBAscii
+{
+    static constexpr USHORT usBufferSize = 1 + 2 * 256 + 2;
+    static constexpr USHORT usPDUOff = 1;
+    static constexpr bool xAddressed = true;
+
+    /*! \brief Converts the frame to binary in place and checks it. */
+    static BOOL     xDecode( UCHAR * pucADU, USHORT usLength, UCHAR * pucAddress, USHORT * pusPDULength )
+    {
+        BOOL            xValid = FALSE;
+        USHORT          usNBytes;
+        UCHAR           ucLRC = 0;
+
+        if( ( usLength >= 3 ) && ( pucADU[0] == ':' ) &&
+            ( pucADU[usLength - 2] == '\r' ) && ( pucADU[usLength - 1] == '\n' ) )
+        {
+            usNBytes = ( USHORT )( ( usLength - 3 ) / 2 );
+            if( usNBytes <= 256 )
+            {
+                for( USHORT i = 0; i < usNBytes; i++ )
+                {
+                    pucADU[i] = ( UCHAR )( ( ucCHAR2BIN( pucADU[1 + 2 * i] ) << 4 ) |
+                                           ucCHAR2BIN( pucADU[2 + 2 * i] ) );
+                    ucLRC = ( UCHAR )( ucLRC + pucADU[i] );
+                }
+                if( ( usNBytes >= 3 ) && ( ucLRC == 0 ) )
+                {
+                    *pucAddress = pucADU[0];
+                    *pusPDULength = ( USHORT )( usNBytes - 1 - 1 );
+                    xValid = TRUE;
+                }
+            }
+        }
+        return xValid;
+    }
+
+    /*! \brief Adds the address and the LRC and converts the frame to characters in place. */
+    static USHORT   usEncode( UCHAR * pucADU, UCHAR ucAddress, USHORT usPDULength )
+    {
+        USHORT          usNBytes = ( USHORT )( 1 + usPDULength );
+        UCHAR           ucLRC = 0;
+
+        pucADU[0] = ucAddress;
+        for( USHORT i = 0; i < usNBytes; i++ )
+        {
+            ucLRC = ( UCHAR )( ucLRC + pucADU[i] );
+        }
+        pucADU[usNBytes++] = ( UCHAR )( -( ( CHAR ) ucLRC ) );
+
+        /* Expand from the end so that no byte is overwritten before it has
+         * been converted. */
+        pucADU[1 + 2 * usNBytes] = '\r';
+        pucADU[2 + 2 * usNBytes] = '\n';
+        for( USHORT i = usNBytes; i > 0; i-- )
+        {
+            UCHAR           ucByte = pucADU[i - 1];
+
+            pucADU[2 * i - 1] = ucBIN2CHAR( ( UCHAR )( ucByte >> 4 ) );
+            pucADU[2 * i] = ucBIN2CHAR( ( UCHAR )( ucByte & 0x0F ) );
+        }
+        pucADU[0] = ':';
+        return ( USHORT )( 1 + 2 * usNBytes + 2 );
+    }
+
+  private:
+    static constexpr UCHAR ucCHAR2BIN( UCHAR ucCharacter )
+    {
+        UCHAR           ucResult = 0xFF;
+
+        if( ( ucCharacter >= '0' ) && ( ucCharacter <= '9' ) )
+        {
+            ucResult = ( UCHAR )( ucCharacter - '0' );
+        }
+        else if( ( ucCharacter >= 'A' ) && ( ucCharacter <= 'F' ) )
+        {
+            ucResult = ( UCHAR )( ucCharacter - 'A' + 0x0A );
+        }
+        return ucResult;
+    }
+
+    static constexpr UCHAR ucBIN2CHAR( UCHAR ucByte )
+    {
+        return ( UCHAR )( ( ucByte <= 0x09 ) ? ( '0' + ucByte ) : ( ucByte - 0x0A + 'A' ) );
+    }
+};
+
+/*! \brief Modbus TCP framing: MBAP header and PDU. */
+struct MBTcp
+{
+    static constexpr USHORT usBufferSize = 7 + MB_PDU_SIZE_MAX;
+    static constexpr USHORT usPDUOff = 7;
+    /*! \brief The unit identifier is not checked and every request is answered. */
+    static constexpr bool xAddressed = false;
+
+    /*! \brief Checks the protocol identifier and the length of the MBAP header. */
+    static BOOL     xDecode( UCHAR * pucADU, USHORT usLength, UCHAR * pucAddress, USHORT * pusPDULength )
+    {
+        BOOL            xValid = FALSE;
+
+        if( ( usLength > usPDUOff ) && ( usLength <= usBufferSize ) &&
+            ( Detail::usMBGetU16( &pucADU[2] ) == 0 ) &&
+            ( Detail::usMBGetU16( &pucADU[4] ) == ( USHORT )( usLength - 6 ) ) )
+        {
+            *pucAddress = pucADU[6];
+            *pusPDULength = ( USHORT )( usLength - usPDUOff );
+            xValid = TRUE;
+        }
+        return xValid;
+    }
+
+    /*! \brief Updates the length of the MBAP header. The other fields are
+     * those of the request. */
+    static USHORT   usEncode( UCHAR * pucADU, UCHAR, USHORT usPDULength )
+    {
+        pucADU[4] = ( UCHAR )( ( usPDULength + 1 ) >> 8 );
+        pucADU[5] = ( UCHAR )( ( usPDULength + 1 ) & 0xFF );
+        return ( USHORT )( usPDUOff + usPDULength );
+    }
+};
+
+/* ----------------------- Slave --------------------------------------------*/
+/*! \brief A Modbus slave which is assembled at compile time.
+ *
+ * \tparam Transport MB::MBRtu, MB::MBAscii or MB::MBTcp.
+ * \tparam Port Class which receives and sends complete frames.
+ * \tparam RegMap Class with the register callbacks.
+ */
+template< class Transport, class Port, class RegMap = MBRegCallbacks >
+class MBSlave
+{
+    static_assert( requires( UCHAR * pucADU, USHORT usValue, USHORT * pusValue )
+                   {
+                   Port::xMBPortFrameReceive( pucADU, usValue, pusValue );
+                   Port::xMBPortFrameSend( pucADU, usValue );
+                   }, "Port must provide xMBPortFrameReceive( ) and xMBPortFrameSend( )" );
+    static_assert( Detail::MBHasInput< RegMap > || Detail::MBHasHolding< RegMap > ||
+                   Detail::MBHasCoils< RegMap > || Detail::MBHasDiscrete< RegMap >,
+                   "RegMap must provide at least one register callback" );
+
+  public:
+    /*! \brief Creates a slave.
+     *
+     * \param ucSlaveAddress The slave address. It must be between
+     *   1 and 247 for RTU and ASCII and is not used for TCP.
+     */
+    explicit constexpr MBSlave( UCHAR ucSlaveAddress ) noexcept:ucMBAddress( ucSlaveAddress )
+    {
+    }
+
+    /*! \brief Executes the next request received by the port.
+     *
+     * Does nothing if the port has no frame. Otherwise the frame is
+     * checked, the request is executed and the response is sent unless
+     * the request was a broadcast.
+     *
+     * \return MB_EIO if the response could not be sent. Otherwise
+     *   MB_ENOERR.
+     */
+    eMBErrorCode    eMBPoll(  )
+    {
+        eMBErrorCode    eStatus = MB_ENOERR;
+        UCHAR          *pucFrame = &aucADU[Transport::usPDUOff];
+        UCHAR           ucRcvAddress;
+        UCHAR           ucFunctionCode;
+        USHORT          usLength;
+        eMBException    eException;
+
+        if( Port::xMBPortFrameReceive( aucADU, sizeof( aucADU ), &usLength ) &&
+            Transport::xDecode( aucADU, usLength, &ucRcvAddress, &usLength ) &&
+            ( !Transport::xAddressed || ( ucRcvAddress == ucMBAddress ) ||
+              ( ucRcvAddress == MB_ADDRESS_BROADCAST ) ) )
+        {
+            ucFunctionCode = pucFrame[MB_PDU_FUNC_OFF];
+            eException = Detail::eMBExecute< RegMap >( pucFrame, &usLength );
+            if( !Transport::xAddressed || ( ucRcvAddress != MB_ADDRESS_BROADCAST ) )
+            {
+                if( eException != MB_EX_NONE )
+                {
+                    usLength = 0;
+                    pucFrame[usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
+                    pucFrame[usLength++] = eException;
+                }
+                usLength = Transport::usEncode( aucADU, ucMBAddress, usLength );
+                if( !Port::xMBPortFrameSend( aucADU, usLength ) )
+                {
+                    eStatus = MB_EIO;
+                }
+            }
+        }
+        return eStatus;
+    }
+
+  private:
+    UCHAR           ucMBAddress;
+    UCHAR           aucADU[Transport::usBufferSize];
+};
+}
+
+/*! @} */
+#endif
@@ -0,0 +1,155 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_STATS_H
+#define _MB_STATS_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_stats Statistics
+ * \code #include "mbstats.h" \endcode
+ *
+ * If MB_STATS_ENABLED is set to <code>1</code> the protocol stack counts
+ * requests and exceptions per function code as well as errors detected by
+ * the RTU/ASCII frame layer. Optionally (MB_STATS_LATENCY_ENABLED) a
+ * histogram of the time between the reception of a frame and the start of
+ * the response is recorded.
+ *
+ * Every counter is only written from a single context (either the task
+ * calling eMBPoll( ) or the serial interrupt) and therefore no locking is
+ * required. The application can take a snapshot at any time by calling
+ * eMBGetStats( ) and compute differences between two snapshots. If the
+ * statistics are disabled all hooks in the protocol stack compile to nothing.
+ */
+/*! \addtogroup modbus_stats
+ *  @{
+ */
+/* ----------------------- Defines ------------------------------------------*/
+/*! \brief Number of counters in the per function code tables. */
+#define MB_STATS_FUNC_CODES         ( 128 )
+
+/*! \brief Number of counters in the per exception code table. */
+#define MB_STATS_EXCEPTION_CODES    ( 12 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+#if MB_STATS_ENABLED > 0
+/*! \brief Snapshot of the protocol stack statistics. */
+typedef struct
+{
+    /*! \brief Requests addressed to this slave (including broadcasts)
+     *   indexed by the function code. */
+    ULONG           ulRequests[MB_STATS_FUNC_CODES];
+
+    /*! \brief Broadcast requests indexed by the function code. */
+    ULONG           ulBroadcasts[MB_STATS_FUNC_CODES];
+
+    /*! \brief Requests answered with an exception indexed by the function
+     *   code. */
+    ULONG           ulExceptions[MB_STATS_FUNC_CODES];
+
+    /*! \brief Exceptions indexed by the exception code. */
+    ULONG           ulExceptionCodes[MB_STATS_EXCEPTION_CODES];
+
+    /*! \brief Frames dropped because of a wrong length or a CRC/LRC error. */
+    ULONG           ulChecksumErrors;
+
+    /*! \brief Frames dropped because the receive buffer overflowed. */
+    ULONG           ulOverruns;
+
+    /*! \brief Valid frames addressed to other slaves. */
+    ULONG           ulOtherAddress;
+
+    /*! \brief Responses which could not be sent because the frame layer
+     *   was busy (E.g. the master already started a new request). */
+    ULONG           ulSendAborts;
+
+#if MB_STATS_LATENCY_ENABLED > 0
+    /*! \brief Histogram of the time in microseconds between the reception
+     *   of a frame and the start of the response. Bucket <code>i</code>
+     *   counts latencies in the range <code>[2^i, 2^(i+1))</code>. Bucket
+     *   0 also counts a latency of 0 and the last bucket all larger values. */
+    ULONG           ulLatency[MB_STATS_LATENCY_BUCKETS];
+#endif
+} xMBStats;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Take a snapshot of the protocol stack statistics.
+ *
+ * The counters are copied without locking. A snapshot may therefore miss
+ * events which happen while the copy is taken but counters are never
+ * corrupted.
+ *
+ * \param pxStats Buffer where the snapshot is stored.
+ * \return eMBErrorCode::MB_EINVAL if \c pxStats is \c NULL. Otherwise
+ *   eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBGetStats( xMBStats * pxStats );
+
+/*! @} */
+
+/* ----------------------- Internal hooks -----------------------------------*/
+extern volatile xMBStats xMBStatsCounters;
+
+void            vMBStatsException( UCHAR ucFunctionCode, eMBException eException );
+
+#define MB_STATS_INC( xCounter ) \
+    ( xMBStatsCounters.xCounter++ )
+#define MB_STATS_INC_FUNC( xCounter, ucFunctionCode ) \
+    ( xMBStatsCounters.xCounter[( ucFunctionCode ) & 0x7F]++ )
+#define MB_STATS_EXCEPTION( ucFunctionCode, eException ) \
+    vMBStatsException( ucFunctionCode, eException )
+
+#if MB_STATS_LATENCY_ENABLED > 0
+void            vMBStatsFrameReceived( void );
+void            vMBStatsSendStarted( void );
+
+#define MB_STATS_FRAME_RECEIVED( )  vMBStatsFrameReceived( )
+#define MB_STATS_SEND_STARTED( )    vMBStatsSendStarted( )
+#endif
+
+#else
+/*! @} */
+#define MB_STATS_INC( xCounter )
+#define MB_STATS_INC_FUNC( xCounter, ucFunctionCode )
+#define MB_STATS_EXCEPTION( ucFunctionCode, eException )
+#endif
+
+#ifndef MB_STATS_FRAME_RECEIVED
+#define MB_STATS_FRAME_RECEIVED( )
+#define MB_STATS_SEND_STARTED( )
+#endif
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
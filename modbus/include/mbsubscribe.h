@@ -0,0 +1,163 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_SUBSCRIBE_H
+#define _MB_SUBSCRIBE_H
+
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbregmap.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_subscribe Subscriptions
+ * \code #include "mbsubscribe.h" \endcode
+ *
+ * Consumers within the application, e.g. a display or a data logger, can
+ * subscribe to a range of a register table instead of reading it
+ * periodically. The protocol stack reads the range with the same callbacks
+ * or register map as a request and calls the callback of the subscription
+ * with all values of the range if at least one value has changed by more
+ * than the deadband. The deadband is ignored for coils and discrete inputs.
+ *
+ * A subscription is checked when it was marked as changed. Writes by the
+ * master mark the overlapping subscriptions automatically. Application
+ * code which changes values calls vMBSubscriptionNotify( ). Subscriptions
+ * with the flag MB_SUBSCRIBE_POLL are checked every time.
+ *
+ * The checks are done by vMBSubscriptionDispatch( ). The protocol stack
+ * calls it after a request was executed. If eMBPoll( ) has nothing to do it
+ * checks the subscriptions which were marked as changed, so values changed
+ * by the application are also reported without traffic on the bus.
+ * Subscriptions with the flag MB_SUBSCRIBE_POLL are not marked, so their
+ * changes are only found when the subscriptions are checked for another
+ * reason. vMBSubscriptionDispatch( ) can also be called by the
+ * application, but only from the task calling eMBPoll( ) because it uses
+ * the register callbacks. A callback which must wake another thread, e.g.
+ * with an eventfd, has to do this itself.
+ *
+ * \code
+ * static xMBSubscription xSetpoints;
+ * static UCHAR    ucSetpointsLast[2 * 10];
+ *
+ * static void
+ * vSetpointsChanged( xMBSubscription * pxSub, const UCHAR * pucValues )
+ * {
+ *     ...
+ * }
+ *
+ * eMBSubscribe( &xSetpoints, MB_REG_MAP_HOLDING, 1001, 10, 5, 0,
+ *               ucSetpointsLast, vSetpointsChanged, NULL );
+ * \endcode
+ */
+/*! \addtogroup modbus_subscribe
+ *  @{
+ */
+/* ----------------------- Defines ------------------------------------------*/
+/*! \brief Check the subscription in every call to vMBSubscriptionDispatch( ). */
+#define MB_SUBSCRIBE_POLL           ( 0x01 )
+/*! \brief Compare the registers as signed values. */
+#define MB_SUBSCRIBE_SIGNED         ( 0x02 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct xMBSubscriptionStruct xMBSubscription;
+
+/*! \brief Called with all values of the range if some have changed.
+ *
+ * \param pxSub The subscription.
+ * \param pucValues The values in the same format as the buffer of the
+ *   register callbacks.
+ */
+typedef void    ( *pvMBSubscriptionCB ) ( xMBSubscription * pxSub, const UCHAR * pucValues );
+
+/*! \brief A subscription. The members are private to the protocol stack. */
+struct xMBSubscriptionStruct
+{
+    eMBRegMapTable  eTable;
+    USHORT          usAddress;
+    USHORT          usNRegs;
+    USHORT          usDeadband;
+    UCHAR           ucFlags;
+    UCHAR          *pucLast;
+    pvMBSubscriptionCB pvCallback;
+    void           *pvArg;          /*!< Argument for the callback. */
+    volatile UCHAR  ucDirty;
+    BOOL            xValid;
+};
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Subscribe to a range of a register table.
+ *
+ * \param pxSub The subscription.
+ * \param eTable The table.
+ * \param usAddress First address as passed to the callbacks.
+ * \param usNRegs Number of registers or bits. At most
+ *   MB_SUBSCRIBE_REGS_MAX registers or 16 times as many bits.
+ * \param usDeadband A register has changed if it differs by more than this
+ *   value from the value last reported.
+ * \param ucFlags MB_SUBSCRIBE_POLL, MB_SUBSCRIBE_SIGNED or zero.
+ * \param pucLast Storage for the values last reported. Two bytes per
+ *   register or one byte per eight bits.
+ * \param pvCallback The callback.
+ * \param pvArg Argument stored in the subscription.
+ *
+ * \return eMBErrorCode::MB_EINVAL if an argument is invalid, if no
+ *   function uses the table or if \c pxSub is already registered.
+ *   eMBErrorCode::MB_ENORES if MB_SUBSCRIBE_MAX
+ *   subscriptions are registered. Otherwise eMBErrorCode::MB_ENOERR.
+ */
+eMBErrorCode    eMBSubscribe( xMBSubscription * pxSub, eMBRegMapTable eTable,
+                              USHORT usAddress, USHORT usNRegs, USHORT usDeadband,
+                              UCHAR ucFlags, UCHAR * pucLast,
+                              pvMBSubscriptionCB pvCallback, void *pvArg );
+
+/*! \brief Remove a subscription. */
+void            vMBUnsubscribe( xMBSubscription * pxSub );
+
+/*! \brief Mark the subscriptions overlapping a range as changed.
+ *
+ * Can be called from any thread.
+ */
+void            vMBSubscriptionNotify( eMBRegMapTable eTable, USHORT usAddress,
+                                       USHORT usNRegs );
+
+/*! \brief Check the changed subscriptions and call their callbacks. */
+void            vMBSubscriptionDispatch( void );
+
+/*! \brief Call vMBSubscriptionDispatch( ) if a subscription has been marked
+ *   as changed since the last call. */
+void            vMBSubscriptionDispatchChanged( void );
+
+/*! @} */
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -99,6 +99,63 @@ void            xMBUtilSetBits( UCHAR * ucByteBuf, USHORT usBitOffset,
 UCHAR           xMBUtilGetBits( UCHAR * ucByteBuf, USHORT usBitOffset,
                                 UCHAR ucNBits );
 
+/*! \brief Copy a range of bits between two bit fields.
+ *
+ * The bits are numbered as in xMBUtilSetBits( ), i.e. the least significant
+ * bit of the first byte is bit zero. The offsets need not be byte aligned.
+ * If both offsets have the same position within a byte the bytes in between
+ * are copied with memcpy( ). Otherwise they are shifted into place several
+ * bytes at a time. Bits in the destination outside of the range are not
+ * changed and no byte after the range is accessed.
+ *
+ * Large coil transfers should use this function instead of calling
+ * xMBUtilSetBits( ) for every eight bits.
+ *
+ * \param pucDst The destination bit field.
+ * \param usDstOffset Offset of the first destination bit.
+ * \param pucSrc The source bit field. It must not overlap the destination.
+ * \param usSrcOffset Offset of the first source bit.
+ * \param usNBits Number of bits to copy.
+ */
+void            vMBUtilCopyBits( UCHAR * pucDst, USHORT usDstOffset,
+                                 const UCHAR * pucSrc, USHORT usSrcOffset,
+                                 USHORT usNBits );
+
+/*! \brief Copy registers from a host array into a PDU buffer.
+ *
+ * The registers are stored in big endian byte order in the buffer. This
+ * function can be used in the register callbacks instead of converting
+ * each register. Depending on the host it uses SSE2, AVX2 or NEON
+ * instructions.
+ *
+ * \param pucDst The buffer passed to the callback. Need not be aligned.
+ * \param pusSrc The registers.
+ * \param usNRegs Number of registers.
+ *
+ * \code
+ * eMBErrorCode
+ * eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+ * {
+ *     ...
+ *     vMBUtilCopyRegsToPDU( pucRegBuffer, &usRegInputBuf[usAddress - usRegInputStart], usNRegs );
+ *     ...
+ * }
+ * \endcode
+ */
+void            vMBUtilCopyRegsToPDU( UCHAR * pucDst, const USHORT * pusSrc,
+                                      USHORT usNRegs );
+
+/*! \brief Copy registers from a PDU buffer into a host array.
+ *
+ * This is the reverse of vMBUtilCopyRegsToPDU( ).
+ *
+ * \param pusDst The registers.
+ * \param pucSrc The buffer passed to the callback. Need not be aligned.
+ * \param usNRegs Number of registers.
+ */
+void            vMBUtilCopyRegsFromPDU( USHORT * pusDst, const UCHAR * pucSrc,
+                                        USHORT usNRegs );
+
 /*! @} */
 
 #ifdef __cplusplus
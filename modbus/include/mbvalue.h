@@ -0,0 +1,144 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _MB_VALUE_H
+#define _MB_VALUE_H
+
+#include "mb.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+/*! \defgroup modbus_value Typed Values
+ * \code #include "mbvalue.h" \endcode
+ *
+ * Devices store 32 and 64 bit integers and floating point values in two or
+ * four consecutive registers. The byte order of these values is not defined
+ * by the Modbus specification and different devices use different orders.
+ * The functions in this module convert values between a register buffer, as
+ * passed to the register callbacks, and native variables. The order is named
+ * after the position of the bytes of a 32 bit value <code>0xAABBCCDD</code>
+ * in the buffer. For 64 bit values the same rules are applied to four
+ * registers.
+ *
+ * The batch functions convert arrays of values. The order is evaluated once
+ * per call and each value is converted without any branches.
+ *
+ * \code
+ * static float    fMeasurements[16];
+ *
+ * eMBErrorCode
+ * eMBRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs )
+ * {
+ *     ...
+ *     // Two registers per value. Low register first.
+ *     vMBValueEncodeFloat( pucRegBuffer, &fMeasurements[( usAddress - 1 ) / 2],
+ *                          usNRegs / 2, MB_VALUE_CDAB );
+ *     ...
+ * }
+ * \endcode
+ */
+/*! \addtogroup modbus_value
+ *  @{
+ */
+/* ----------------------- Type definitions ---------------------------------*/
+/*! \brief Byte order of multi register values. */
+typedef enum
+{
+    MB_VALUE_ABCD = 0,          /*!< Big endian. The order used by Modbus for a register. */
+    MB_VALUE_BADC = 1,          /*!< Big endian with the bytes of each register swapped. */
+    MB_VALUE_CDAB = 2,          /*!< Low register first. */
+    MB_VALUE_DCBA = 3           /*!< Little endian. */
+} eMBValueOrder;
+
+/* ----------------------- Function prototypes ------------------------------*/
+/*! \brief Read an unsigned 32 bit value from two registers. */
+ULONG           ulMBValueGetU32( const UCHAR * pucBuf, eMBValueOrder eOrder );
+
+/*! \brief Read a signed 32 bit value from two registers. */
+LONG            lMBValueGetS32( const UCHAR * pucBuf, eMBValueOrder eOrder );
+
+/*! \brief Read a single precision IEEE 754 value from two registers. */
+float           fMBValueGetFloat( const UCHAR * pucBuf, eMBValueOrder eOrder );
+
+/*! \brief Write a 32 bit value into two registers.
+ *
+ * Signed values can be passed as well. Bits above bit 31 are ignored.
+ */
+void            vMBValueSetU32( UCHAR * pucBuf, ULONG ulValue, eMBValueOrder eOrder );
+
+/*! \brief Write a single precision IEEE 754 value into two registers. */
+void            vMBValueSetFloat( UCHAR * pucBuf, float fValue, eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues 32 bit values from a register buffer. */
+void            vMBValueDecodeU32( ULONG * pulDst, const UCHAR * pucSrc, USHORT usNValues,
+                                   eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues 32 bit values into a register buffer. */
+void            vMBValueEncodeU32( UCHAR * pucDst, const ULONG * pulSrc, USHORT usNValues,
+                                   eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues single precision values from a register buffer. */
+void            vMBValueDecodeFloat( float *pfDst, const UCHAR * pucSrc, USHORT usNValues,
+                                     eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues single precision values into a register buffer. */
+void            vMBValueEncodeFloat( UCHAR * pucDst, const float *pfSrc, USHORT usNValues,
+                                     eMBValueOrder eOrder );
+
+#if MB_VALUE_64_ENABLED > 0
+/*! \brief Read an unsigned 64 bit value from four registers. */
+unsigned long long ullMBValueGetU64( const UCHAR * pucBuf, eMBValueOrder eOrder );
+
+/*! \brief Read a double precision IEEE 754 value from four registers. */
+double          dMBValueGetDouble( const UCHAR * pucBuf, eMBValueOrder eOrder );
+
+/*! \brief Write a 64 bit value into four registers. */
+void            vMBValueSetU64( UCHAR * pucBuf, unsigned long long ullValue,
+                                eMBValueOrder eOrder );
+
+/*! \brief Write a double precision IEEE 754 value into four registers. */
+void            vMBValueSetDouble( UCHAR * pucBuf, double dValue, eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues double precision values from a register buffer. */
+void            vMBValueDecodeDouble( double *pdDst, const UCHAR * pucSrc, USHORT usNValues,
+                                      eMBValueOrder eOrder );
+
+/*! \brief Convert usNValues double precision values into a register buffer. */
+void            vMBValueEncodeDouble( UCHAR * pucDst, const double *pdSrc, USHORT usNValues,
+                                      eMBValueOrder eOrder );
+#endif
+
+/*! @} */
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -40,6 +40,11 @@
 #include "mbframe.h"
 #include "mbproto.h"
 #include "mbfunc.h"
+#include "mbstats.h"
+#include "mbdiag.h"
+#include "mbhooks.h"
+#include "mbdefer.h"
+#include "mbexec.h"
 
 #include "mbport.h"
 #if MB_RTU_ENABLED == 1
@@ -56,10 +61,29 @@
 #define MB_PORT_HAS_CLOSE 0
 #endif
 
+/* Number of entries of xFuncHandlers which are enabled in mbconfig.h. */
+#define MB_FUNC_HANDLERS_ENABLED \
+    ( ( MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0 ) + ( MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0 ) + \
+      ( MB_FUNC_READ_INPUT_ENABLED > 0 ) + ( MB_FUNC_READ_HOLDING_ENABLED > 0 ) + \
+      ( MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED > 0 ) + ( MB_FUNC_WRITE_HOLDING_ENABLED > 0 ) + \
+      ( MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0 ) + ( MB_FUNC_READ_FIFO_ENABLED > 0 ) + \
+      ( MB_FUNC_READWRITE_HOLDING_ENABLED > 0 ) + ( MB_FUNC_READ_COILS_ENABLED > 0 ) + \
+      ( MB_FUNC_WRITE_COIL_ENABLED > 0 ) + ( MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0 ) + \
+      ( MB_FUNC_READ_DISCRETE_INPUTS_ENABLED > 0 ) + ( MB_FUNC_WRITE_FILE_ENABLED > 0 ) + \
+      ( MB_FUNC_READ_FILE_ENABLED > 0 ) + ( MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0 ) + \
+      2 * ( MB_FUNC_DIAG_COM_EVENT_ENABLED > 0 ) )
+
+#if MB_FUNC_HANDLERS_ENABLED > MB_FUNC_HANDLERS_MAX
+#error "MB_FUNC_HANDLERS_MAX is smaller than the number of enabled function codes"
+#endif
+
 /* ----------------------- Static variables ---------------------------------*/
 
 static UCHAR    ucMBAddress;
 static eMBMode  eMBCurrentMode;
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+static BOOL     xMBFrameSending;
+#endif
 
 static enum
 {
@@ -88,6 +112,11 @@ BOOL( *pxMBPortCBTimerExpired ) ( void );
 BOOL( *pxMBFrameCBReceiveFSMCur ) ( void );
 BOOL( *pxMBFrameCBTransmitFSMCur ) ( void );
 
+/* ----------------------- Static functions ---------------------------------*/
+static eMBErrorCode prveMBSendResponse( UCHAR ucRcvAddress, UCHAR ucFunctionCode,
+                                        UCHAR * pucFrame, USHORT usLength,
+                                        eMBException eException );
+
 /* An array of Modbus functions handlers which associates Modbus function
  * codes with implementing functions.
  */
@@ -95,6 +124,9 @@ static xMBFunctionHandler xFuncHandlers[MB_FUNC_HANDLERS_MAX] = {
 #if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
     {MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID},
 #endif
+#if MB_FUNC_OTHER_DEVICE_ID_ENABLED > 0
+    {MB_FUNC_OTHER_ENCAP_INTERFACE, eMBFuncEncapInterface},
+#endif
 #if MB_FUNC_READ_INPUT_ENABLED > 0
     {MB_FUNC_READ_INPUT_REGISTER, eMBFuncReadInputRegister},
 #endif
@@ -107,6 +139,12 @@ static xMBFunctionHandler xFuncHandlers[MB_FUNC_HANDLERS_MAX] = {
 #if MB_FUNC_WRITE_HOLDING_ENABLED > 0
     {MB_FUNC_WRITE_REGISTER, eMBFuncWriteHoldingRegister},
 #endif
+#if MB_FUNC_MASK_WRITE_HOLDING_ENABLED > 0
+    {MB_FUNC_MASK_WRITE_REGISTER, eMBFuncMaskWriteHoldingRegister},
+#endif
+#if MB_FUNC_READ_FIFO_ENABLED > 0
+    {MB_FUNC_READ_FIFO_QUEUE, eMBFuncReadFifoQueue},
+#endif
 #if MB_FUNC_READWRITE_HOLDING_ENABLED > 0
     {MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBFuncReadWriteMultipleHoldingRegister},
 #endif
@@ -128,6 +166,13 @@ static xMBFunctionHandler xFuncHandlers[MB_FUNC_HANDLERS_MAX] = {
 #if MB_FUNC_READ_FILE_ENABLED
     {MB_FUNC_READ_FILE_RECORD, eMBFuncReadFileRecord},
 #endif
+#if MB_FUNC_DIAG_DIAGNOSTIC_ENABLED > 0
+    {MB_FUNC_DIAG_DIAGNOSTIC, eMBFuncDiagnostic},
+#endif
+#if MB_FUNC_DIAG_COM_EVENT_ENABLED > 0
+    {MB_FUNC_DIAG_GET_COM_EVENT_CNT, eMBFuncGetCommEventCounter},
+    {MB_FUNC_DIAG_GET_COM_EVENT_LOG, eMBFuncGetCommEventLog},
+#endif
 };
 
 /* ----------------------- Start implementation -----------------------------*/
@@ -359,6 +404,9 @@ eMBEnable( void )
     {
         /* Activate the protocol stack. */
         pvMBFrameStartCur(  );
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+        xMBFrameSending = FALSE;
+#endif
         eMBState = STATE_ENABLED;
     }
     else
@@ -402,6 +450,15 @@ eMBPoll( void )
     int             i;
     eMBErrorCode    eStatus = MB_ENOERR;
     eMBEventType    eEvent;
+#if MB_EXEC_ENABLED > 0
+    pxMBFunctionHandler pxHandler;
+#endif
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+    UCHAR          *pucTxFrame;
+    UCHAR           ucTxAddress;
+    USHORT          usTxLength;
+    eMBException    eTxException;
+#endif
 
     /* Check if the protocol stack is ready. */
     if( eMBState != STATE_ENABLED )
@@ -419,20 +476,36 @@ eMBPoll( void )
             break;
 
         case EV_FRAME_RECEIVED:
+            MB_STATS_FRAME_RECEIVED(  );
             eStatus = peMBFrameReceiveCur( &ucRcvAddress, &ucMBFrame, &usLength );
             if( eStatus == MB_ENOERR )
             {
+                MB_DIAG_INC( MB_DIAG_CNT_BUS_MESSAGE );
+
                 /* Check if the frame is for us. If not ignore the frame. */
                 if( ( ucRcvAddress == ucMBAddress ) || ( ucRcvAddress == MB_ADDRESS_BROADCAST ) )
                 {
+                    MB_DIAG_INC( MB_DIAG_CNT_SLAVE_MESSAGE );
+                    MB_DIAG_EVENT_RX( ( ucRcvAddress == MB_ADDRESS_BROADCAST ) ?
+                                      MB_DIAG_EVENT_RX_BROADCAST : 0 );
                     ( void )xMBPortEventPost( EV_EXECUTE );
                 }
+                else
+                {
+                    MB_STATS_INC( ulOtherAddress );
+                }
+            }
+            else
+            {
+                MB_DIAG_EVENT_RX( MB_DIAG_EVENT_RX_COMM_ERROR );
             }
             break;
 
         case EV_EXECUTE:
             ucFunctionCode = ucMBFrame[MB_PDU_FUNC_OFF];
-            eException = MB_EX_ILLEGAL_FUNCTION;
+            MB_STATS_INC_FUNC( ulRequests, ucFunctionCode );
+#if MB_EXEC_ENABLED > 0
+            pxHandler = NULL;
             for( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
             {
                 /* No more function handlers registered. Abort. */
@@ -442,40 +515,151 @@ eMBPoll( void )
                 }
                 else if( xFuncHandlers[i].ucFunctionCode == ucFunctionCode )
                 {
-                    eException = xFuncHandlers[i].pxHandler( ucMBFrame, &usLength );
+                    pxHandler = xFuncHandlers[i].pxHandler;
                     break;
                 }
             }
-
-            /* If the request was not sent to the broadcast address we
-             * return a reply. */
-            if( ucRcvAddress != MB_ADDRESS_BROADCAST )
+            /* The handler is called by the executor. The response is sent
+             * by a later call when all earlier responses have been sent. */
+            vMBExecSubmit( ucRcvAddress, ucMBFrame, usLength,
+                           ( eMBCurrentMode == MB_TCP ) ? MB_EXEC_HEADROOM : 0, pxHandler );
+            eException = MB_EX_PENDING;
+#else
+            eException = MB_EX_ILLEGAL_FUNCTION;
+#if MB_DEFER_ENABLED > 0
+            vMBDeferBegin( ucRcvAddress, ucMBFrame,
+                           ( eMBCurrentMode == MB_TCP ) ? MB_DEFER_HEADROOM : 0 );
+#endif
+            if( MB_HOOK_REQUEST_CACHED( ucRcvAddress, ucMBFrame, &usLength ) )
+            {
+                eException = MB_EX_NONE;
+            }
+            else
             {
-                if( eException != MB_EX_NONE )
+                for( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
                 {
-                    /* An exception occured. Build an error frame. */
-                    usLength = 0;
-                    ucMBFrame[usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
-                    ucMBFrame[usLength++] = eException;
+                    /* No more function handlers registered. Abort. */
+                    if( xFuncHandlers[i].ucFunctionCode == 0 )
+                    {
+                        break;
+                    }
+                    else if( xFuncHandlers[i].ucFunctionCode == ucFunctionCode )
+                    {
+                        eException = xFuncHandlers[i].pxHandler( ucMBFrame, &usLength );
+                        break;
+                    }
                 }
-#if MB_ASCII_ENABLED > 0
-                if( ( eMBCurrentMode == MB_ASCII ) && MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS )
-                {
-                    vMBPortTimersDelay( MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS );
-                }                
-#elif MB_RTU_ENABLED > 0
-                if ( ( eMBCurrentMode == MB_RTU ) && MB_RTU_TIMEOUT_WAIT_BEFORE_SEND_MS )
+                if( eException == MB_EX_NONE )
                 {
-                    vMBPortTimersDelay( MB_RTU_TIMEOUT_WAIT_BEFORE_SEND_MS );
+                    MB_HOOK_RESPONSE( ucMBFrame, usLength );
                 }
+            }
+#if MB_DEFER_ENABLED > 0
+            vMBDeferCommit( &eException );
 #endif
-                eStatus = peMBFrameSendCur( ucMBAddress, ucMBFrame, usLength );
+#endif
+            if( eException != MB_EX_PENDING )
+            {
+                eStatus = prveMBSendResponse( ucRcvAddress, ucFunctionCode, ucMBFrame,
+                                              usLength, eException );
             }
+            MB_HOOK_REQUEST_DONE(  );
             break;
 
         case EV_FRAME_SENT:
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+            xMBFrameSending = FALSE;
+#endif
             break;
         }
     }
+#if MB_DEFER_ENABLED > 0
+    /* Send the response of a completed request if the transport is idle. */
+    else if( !xMBFrameSending &&
+             xMBDeferPoll( &pucTxFrame, &ucTxAddress, &usTxLength, &eTxException ) )
+#elif MB_EXEC_ENABLED > 0
+    /* Send the response of the oldest request if it has been executed. */
+    else if( !xMBFrameSending &&
+             xMBExecPoll( &pucTxFrame, &ucTxAddress, &usTxLength, &eTxException ) )
+#endif
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+    {
+        /* The response is sent from a buffer of its own because the buffer
+         * of the transport may already hold the next request. */
+        eStatus = prveMBSendResponse( ucTxAddress, pucTxFrame[MB_PDU_FUNC_OFF], pucTxFrame,
+                                      usTxLength, eTxException );
+#if MB_DEFER_ENABLED > 0
+        vMBDeferSent( ( eStatus == MB_ENOERR ) ? TRUE : FALSE );
+#elif MB_EXEC_ENABLED > 0
+        /* A serial transport can not send while it receives the next
+         * request. A failed TCP connection is not retried. */
+        vMBExecSent( ( ( eStatus == MB_ENOERR ) || ( eMBCurrentMode == MB_TCP ) ) ? TRUE : FALSE );
+#endif
+        MB_HOOK_REQUEST_DONE(  );
+    }
+#endif
+    else
+    {
+        MB_HOOK_IDLE(  );
+    }
+    return eStatus;
+}
+
+static          eMBErrorCode
+prveMBSendResponse( UCHAR ucRcvAddress, UCHAR ucFunctionCode, UCHAR * pucFrame,
+                    USHORT usLength, eMBException eException )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( eException != MB_EX_NONE )
+    {
+        MB_STATS_EXCEPTION( ucFunctionCode, eException );
+    }
+    MB_DIAG_EVENT_TX( ucFunctionCode, eException );
+
+    /* If the request was not sent to the broadcast address we
+     * return a reply. */
+    if( ucRcvAddress != MB_ADDRESS_BROADCAST )
+    {
+        if( eException != MB_EX_NONE )
+        {
+            /* An exception occured. Build an error frame. */
+            MB_DIAG_EXCEPTION( eException );
+            usLength = 0;
+            pucFrame[usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
+            pucFrame[usLength++] = eException;
+        }
+#if MB_ASCII_ENABLED > 0
+        if( ( eMBCurrentMode == MB_ASCII ) && MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS )
+        {
+            vMBPortTimersDelay( MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS );
+        }                
+#elif MB_RTU_ENABLED > 0
+        if ( ( eMBCurrentMode == MB_RTU ) && MB_RTU_TIMEOUT_WAIT_BEFORE_SEND_MS )
+        {
+            vMBPortTimersDelay( MB_RTU_TIMEOUT_WAIT_BEFORE_SEND_MS );
+        }
+#endif
+        MB_STATS_SEND_STARTED(  );
+        eStatus = peMBFrameSendCur( ucMBAddress, pucFrame, usLength );
+        if( eStatus == MB_EIO )
+        {
+            MB_STATS_INC( ulSendAborts );
+            MB_DIAG_INC( MB_DIAG_CNT_SLAVE_NO_RESPONSE );
+        }
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_EXEC_ENABLED > 0 )
+        /* The serial transports signal the end of the frame with
+         * EV_FRAME_SENT. The TCP transport sends synchronously. */
+        else if( eMBCurrentMode != MB_TCP )
+        {
+            xMBFrameSending = TRUE;
+        }
+#endif
+    }
+    else
+    {
+        MB_STATS_INC_FUNC( ulBroadcasts, ucFunctionCode );
+        MB_DIAG_INC( MB_DIAG_CNT_SLAVE_NO_RESPONSE );
+    }
     return eStatus;
 }
@@ -0,0 +1,270 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbport.h"
+#include "mbcache.h"
+
+#if MB_CACHE_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_CACHE_ADDR_OFF       ( MB_PDU_DATA_OFF )
+#define MB_PDU_CACHE_COUNT_OFF      ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_CACHE_REQ_SIZE       ( 5 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    eMBRegMapTable  eTable;
+    USHORT          usAddress;
+    USHORT          usNRegs;
+    ULONG           ulTTLUs;
+} xMBCacheRange;
+
+typedef struct
+{
+    UCHAR           ucUnit;
+    UCHAR           ucFunctionCode;
+    USHORT          usAddress;      /* Address as passed to the callbacks. */
+    USHORT          usNRegs;
+} xMBCacheKey;
+
+typedef struct
+{
+    xMBCacheKey     xKey;
+    BOOL            xValid;
+    ULONG           ulStoredUs;
+    ULONG           ulTTLUs;
+    USHORT          usLength;
+    UCHAR           ucPDU[MB_CACHE_PDU_MAX];
+} xMBCacheEntry;
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBCacheRange xMBCacheRanges[MB_CACHE_RANGES_MAX];
+static USHORT   usMBCacheRanges;
+static xMBCacheEntry xMBCacheEntries[MB_CACHE_ENTRIES];
+
+/* The request which missed the cache. Its response is stored by
+ * vMBCacheStore( ) after the function handler has been called. */
+static xMBCacheKey xMBCacheMiss;
+static ULONG    ulMBCacheMissTTLUs;
+static BOOL     xMBCacheMissValid;
+
+/* ----------------------- Static functions ---------------------------------*/
+static BOOL     prvxMBCacheTable( UCHAR ucFunctionCode, eMBRegMapTable * peTable );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBCacheSetTTL( eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs, ULONG ulTTLUs )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( ( eTable >= MB_REG_MAP_TABLES ) || ( usAddress == 0 ) || ( usNRegs == 0 ) ||
+        ( ( ( ULONG )usAddress + usNRegs ) > 0x10000UL ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else if( usMBCacheRanges >= MB_CACHE_RANGES_MAX )
+    {
+        eStatus = MB_ENORES;
+    }
+    else
+    {
+        xMBCacheRanges[usMBCacheRanges].eTable = eTable;
+        xMBCacheRanges[usMBCacheRanges].usAddress = usAddress;
+        xMBCacheRanges[usMBCacheRanges].usNRegs = usNRegs;
+        xMBCacheRanges[usMBCacheRanges].ulTTLUs = ulTTLUs;
+        usMBCacheRanges++;
+    }
+    return eStatus;
+}
+
+void
+vMBCacheInvalidate( eMBRegMapTable eTable, USHORT usAddress, USHORT usNRegs )
+{
+    eMBRegMapTable  eEntryTable;
+    xMBCacheEntry  *pxEntry;
+    USHORT          usIdx;
+
+    ENTER_CRITICAL_SECTION(  );
+    for( usIdx = 0; usIdx < MB_CACHE_ENTRIES; usIdx++ )
+    {
+        pxEntry = &xMBCacheEntries[usIdx];
+        if( pxEntry->xValid && prvxMBCacheTable( pxEntry->xKey.ucFunctionCode, &eEntryTable ) &&
+            ( eEntryTable == eTable ) &&
+            ( ( ULONG )usAddress < ( ULONG )pxEntry->xKey.usAddress + pxEntry->xKey.usNRegs ) &&
+            ( ( ULONG )pxEntry->xKey.usAddress < ( ULONG )usAddress + usNRegs ) )
+        {
+            pxEntry->xValid = FALSE;
+        }
+    }
+    /* A response which is currently built may contain old values. */
+    if( xMBCacheMissValid && prvxMBCacheTable( xMBCacheMiss.ucFunctionCode, &eEntryTable ) &&
+        ( eEntryTable == eTable ) )
+    {
+        xMBCacheMissValid = FALSE;
+    }
+    EXIT_CRITICAL_SECTION(  );
+}
+
+BOOL
+xMBCacheLookup( UCHAR ucUnit, UCHAR * pucFrame, USHORT * pusLength )
+{
+    eMBRegMapTable  eTable;
+    xMBCacheEntry  *pxEntry;
+    xMBCacheKey     xKey;
+    ULONG           ulNow;
+    USHORT          usIdx;
+    BOOL            xHit = FALSE;
+
+    xMBCacheMissValid = FALSE;
+    if( ( ucUnit != MB_ADDRESS_BROADCAST ) && ( *pusLength == MB_PDU_CACHE_REQ_SIZE ) &&
+        prvxMBCacheTable( pucFrame[MB_PDU_FUNC_OFF], &eTable ) )
+    {
+        xKey.ucUnit = ucUnit;
+        xKey.ucFunctionCode = pucFrame[MB_PDU_FUNC_OFF];
+        xKey.usAddress = ( USHORT )( ( pucFrame[MB_PDU_CACHE_ADDR_OFF] << 8 ) | pucFrame[MB_PDU_CACHE_ADDR_OFF + 1] );
+        xKey.usAddress++;
+        xKey.usNRegs = ( USHORT )( ( pucFrame[MB_PDU_CACHE_COUNT_OFF] << 8 ) | pucFrame[MB_PDU_CACHE_COUNT_OFF + 1] );
+        ulNow = ulMBPortGetTimestampUs(  );
+
+        ENTER_CRITICAL_SECTION(  );
+        for( usIdx = 0; !xHit && ( usIdx < MB_CACHE_ENTRIES ); usIdx++ )
+        {
+            pxEntry = &xMBCacheEntries[usIdx];
+            if( pxEntry->xValid && ( pxEntry->xKey.ucUnit == xKey.ucUnit ) &&
+                ( pxEntry->xKey.ucFunctionCode == xKey.ucFunctionCode ) &&
+                ( pxEntry->xKey.usAddress == xKey.usAddress ) && ( pxEntry->xKey.usNRegs == xKey.usNRegs ) )
+            {
+                if( ( ULONG )( ulNow - pxEntry->ulStoredUs ) < pxEntry->ulTTLUs )
+                {
+                    memcpy( pucFrame, pxEntry->ucPDU, pxEntry->usLength );
+                    *pusLength = pxEntry->usLength;
+                    xHit = TRUE;
+                }
+                else
+                {
+                    pxEntry->xValid = FALSE;
+                }
+            }
+        }
+        EXIT_CRITICAL_SECTION(  );
+
+        /* Remember the request if it lies within a cached range. */
+        for( usIdx = 0; !xHit && !xMBCacheMissValid && ( usIdx < usMBCacheRanges ); usIdx++ )
+        {
+            if( ( xMBCacheRanges[usIdx].eTable == eTable ) &&
+                ( xKey.usAddress >= xMBCacheRanges[usIdx].usAddress ) &&
+                ( ( ( ULONG )xKey.usAddress + xKey.usNRegs ) <=
+                  ( ( ULONG )xMBCacheRanges[usIdx].usAddress + xMBCacheRanges[usIdx].usNRegs ) ) )
+            {
+                xMBCacheMiss = xKey;
+                ulMBCacheMissTTLUs = xMBCacheRanges[usIdx].ulTTLUs;
+                xMBCacheMissValid = TRUE;
+            }
+        }
+    }
+    return xHit;
+}
+
+void
+vMBCacheStore( const UCHAR * pucFrame, USHORT usLength )
+{
+    xMBCacheEntry  *pxEntry = NULL;
+    ULONG           ulNow;
+    USHORT          usIdx;
+
+    ulNow = ulMBPortGetTimestampUs(  );
+    ENTER_CRITICAL_SECTION(  );
+    if( xMBCacheMissValid && ( usLength <= MB_CACHE_PDU_MAX ) )
+    {
+        /* Use a free entry or replace the oldest one. */
+        for( usIdx = 0; usIdx < MB_CACHE_ENTRIES; usIdx++ )
+        {
+            if( !xMBCacheEntries[usIdx].xValid )
+            {
+                pxEntry = &xMBCacheEntries[usIdx];
+                break;
+            }
+            else if( ( pxEntry == NULL ) ||
+                     ( ( ULONG )( ulNow - xMBCacheEntries[usIdx].ulStoredUs ) >
+                       ( ULONG )( ulNow - pxEntry->ulStoredUs ) ) )
+            {
+                pxEntry = &xMBCacheEntries[usIdx];
+            }
+        }
+        pxEntry->xKey = xMBCacheMiss;
+        pxEntry->ulStoredUs = ulNow;
+        pxEntry->ulTTLUs = ulMBCacheMissTTLUs;
+        pxEntry->usLength = usLength;
+        memcpy( pxEntry->ucPDU, pucFrame, usLength );
+        pxEntry->xValid = TRUE;
+    }
+    xMBCacheMissValid = FALSE;
+    EXIT_CRITICAL_SECTION(  );
+}
+
+static          BOOL
+prvxMBCacheTable( UCHAR ucFunctionCode, eMBRegMapTable * peTable )
+{
+    BOOL            xCacheable = TRUE;
+
+    switch ( ucFunctionCode )
+    {
+    case MB_FUNC_READ_COILS:
+        *peTable = MB_REG_MAP_COILS;
+        break;
+    case MB_FUNC_READ_DISCRETE_INPUTS:
+        *peTable = MB_REG_MAP_DISCRETE;
+        break;
+    case MB_FUNC_READ_HOLDING_REGISTER:
+        *peTable = MB_REG_MAP_HOLDING;
+        break;
+    case MB_FUNC_READ_INPUT_REGISTER:
+        *peTable = MB_REG_MAP_INPUT;
+        break;
+    default:
+        xCacheable = FALSE;
+        break;
+    }
+    return xCacheable;
+}
+
+#endif
@@ -0,0 +1,464 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbport.h"
+#include "mbatomic.h"
+#include "mbregmap.h"
+#include "mbhooks.h"
+#include "mbdefer.h"
+
+#if MB_DEFER_ENABLED > 0
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_DEFER_ADDR_OFF       ( MB_PDU_DATA_OFF )
+#define MB_PDU_DEFER_COUNT_OFF      ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_DEFER_READ_DATA_OFF  ( MB_PDU_DATA_OFF + 1 )
+#define MB_PDU_DEFER_WRITE_SIZE     ( 5 )
+
+#define MB_DEFER_FREE               ( 0 )
+#define MB_DEFER_PENDING            ( 1 )
+#define MB_DEFER_COMPLETING         ( 2 )
+#define MB_DEFER_COMPLETE           ( 3 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    USHORT          usState;
+    USHORT          usToken;
+    UCHAR           ucUnit;
+    BOOL            xCancelled;
+    BOOL            xHandler;       /* Deferred by a function handler. */
+    eMBException    eException;
+    ULONG           ulTimeUs;       /* Time of the deferral or completion. */
+    USHORT          usHeadroom;
+    USHORT          usDataOff;
+    USHORT          usNBytes;
+    UCHAR           ucFrame[MB_DEFER_HEADROOM + MB_PDU_SIZE_MAX];
+} xMBDeferSlot;
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBDeferSlot xMBDeferSlots[MB_DEFER_SLOTS];
+static UCHAR    ucMBDeferGeneration;
+
+/* The responses are built in a buffer of their own because the buffer of
+ * the transport may already hold the next request. */
+static UCHAR    ucMBDeferTxBuf[MB_DEFER_HEADROOM + MB_PDU_SIZE_MAX + MB_DEFER_TAILROOM];
+static xMBDeferSlot *pxMBDeferSending;
+
+/* The request which is currently executed by eMBPoll( ). */
+static UCHAR   *pucMBDeferFrame;
+static USHORT   usMBDeferHeadroom;
+static UCHAR    ucMBDeferUnit;
+static xMBDeferSlot *pxMBDeferCurrent;
+
+/* ----------------------- Static functions ---------------------------------*/
+eMBException    prveMBError2Exception( eMBErrorCode eErrorCode );
+static BOOL     prvxMBDeferWriteTable( UCHAR ucFunctionCode, eMBRegMapTable * peTable );
+static xMBDeferSlot *prvpxMBDeferReserve( USHORT usDataOff, USHORT usNBytes, USHORT usCopy,
+                                          BOOL xHandler );
+static xMBDeferSlot *prvpxMBDeferAcquire( USHORT usToken );
+static void     prvvMBDeferRelease( xMBDeferSlot * pxSlot );
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBDeferRequest( UCHAR * pucRegBuffer, USHORT usNBytes, USHORT * pusToken )
+{
+    eMBErrorCode    eStatus = MB_EPENDING;
+    eMBRegMapTable  eTable;
+    xMBDeferSlot   *pxSlot = NULL;
+
+    if( ( pucMBDeferFrame == NULL ) || ( pxMBDeferCurrent != NULL ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else if( prvxMBDeferWriteTable( pucMBDeferFrame[MB_PDU_FUNC_OFF], &eTable ) )
+    {
+        pxSlot = prvpxMBDeferReserve( 0, 0, MB_PDU_DEFER_WRITE_SIZE, FALSE );
+    }
+    else if( ( pucMBDeferFrame[MB_PDU_FUNC_OFF] >= MB_FUNC_READ_COILS ) &&
+             ( pucMBDeferFrame[MB_PDU_FUNC_OFF] <= MB_FUNC_READ_INPUT_REGISTER ) &&
+             ( pucRegBuffer == &pucMBDeferFrame[MB_PDU_DEFER_READ_DATA_OFF] ) &&
+             ( usNBytes <= ( MB_PDU_SIZE_MAX - MB_PDU_DEFER_READ_DATA_OFF ) ) )
+    {
+        pxSlot = prvpxMBDeferReserve( MB_PDU_DEFER_READ_DATA_OFF, usNBytes,
+                                      MB_PDU_DEFER_READ_DATA_OFF, FALSE );
+    }
+    else
+    {
+        eStatus = MB_EINVAL;
+    }
+
+    if( eStatus == MB_EPENDING )
+    {
+        if( pxSlot == NULL )
+        {
+            eStatus = MB_ETIMEDOUT;
+        }
+        else
+        {
+            *pusToken = pxSlot->usToken;
+        }
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBDeferHandler( USHORT * pusToken )
+{
+    eMBErrorCode    eStatus = MB_EPENDING;
+    xMBDeferSlot   *pxSlot;
+
+    if( ( pucMBDeferFrame == NULL ) || ( pxMBDeferCurrent != NULL ) )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else if( ( pxSlot = prvpxMBDeferReserve( 0, 0, MB_PDU_FUNC_OFF + 1, TRUE ) ) == NULL )
+    {
+        eStatus = MB_ETIMEDOUT;
+    }
+    else
+    {
+        *pusToken = pxSlot->usToken;
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBCompleteRequest( USHORT usToken, const UCHAR * pucData, eMBErrorCode eStatus )
+{
+    eMBErrorCode    eResult = MB_ENOERR;
+    xMBDeferSlot   *pxSlot;
+
+    if( ( pxSlot = prvpxMBDeferAcquire( usToken ) ) == NULL )
+    {
+        eResult = MB_EINVAL;
+    }
+    else
+    {
+        if( eStatus != MB_ENOERR )
+        {
+            pxSlot->eException = prveMBError2Exception( eStatus );
+            if( pxSlot->eException == MB_EX_PENDING )
+            {
+                pxSlot->eException = MB_EX_SLAVE_DEVICE_FAILURE;
+            }
+        }
+        else if( pxSlot->xHandler )
+        {
+            pxSlot->eException = MB_EX_SLAVE_DEVICE_FAILURE;
+        }
+        else if( ( pxSlot->usNBytes > 0 ) && ( pucData != NULL ) )
+        {
+            memcpy( &pxSlot->ucFrame[pxSlot->usHeadroom + pxSlot->usDataOff], pucData, pxSlot->usNBytes );
+        }
+        pxSlot->ulTimeUs = ulMBPortGetTimestampUs(  );
+        MB_ATOMIC_STORE_RELEASE( &pxSlot->usState, MB_DEFER_COMPLETE );
+    }
+    return eResult;
+}
+
+eMBErrorCode
+eMBCompleteHandler( USHORT usToken, const UCHAR * pucFrame, USHORT usLength,
+                    eMBException eException )
+{
+    eMBErrorCode    eResult = MB_ENOERR;
+    xMBDeferSlot   *pxSlot;
+
+    if( ( pxSlot = prvpxMBDeferAcquire( usToken ) ) == NULL )
+    {
+        eResult = MB_EINVAL;
+    }
+    else
+    {
+        if( !pxSlot->xHandler || ( eException == MB_EX_PENDING ) ||
+            ( ( eException == MB_EX_NONE ) && ( ( usLength == 0 ) || ( usLength > MB_PDU_SIZE_MAX ) ) ) )
+        {
+            eResult = MB_EINVAL;
+            pxSlot->eException = MB_EX_SLAVE_DEVICE_FAILURE;
+        }
+        else
+        {
+            pxSlot->eException = eException;
+            if( eException == MB_EX_NONE )
+            {
+                memcpy( &pxSlot->ucFrame[pxSlot->usHeadroom], pucFrame, usLength );
+                pxSlot->usNBytes = usLength;
+            }
+        }
+        pxSlot->ulTimeUs = ulMBPortGetTimestampUs(  );
+        MB_ATOMIC_STORE_RELEASE( &pxSlot->usState, MB_DEFER_COMPLETE );
+    }
+    return eResult;
+}
+
+void
+vMBDeferBegin( UCHAR ucUnit, UCHAR * pucFrame, USHORT usHeadroom )
+{
+    pucMBDeferFrame = pucFrame;
+    usMBDeferHeadroom = usHeadroom;
+    ucMBDeferUnit = ucUnit;
+    pxMBDeferCurrent = NULL;
+}
+
+void
+vMBDeferCommit( eMBException * peException )
+{
+    USHORT          usExpected = MB_DEFER_PENDING;
+    BOOL            xSwapped;
+
+    if( ( *peException != MB_EX_PENDING ) || ( pxMBDeferCurrent == NULL ) )
+    {
+        if( *peException == MB_EX_PENDING )
+        {
+            /* The callback did not call eMBDeferRequest( ). */
+            *peException = MB_EX_SLAVE_DEVICE_FAILURE;
+        }
+        else if( pxMBDeferCurrent != NULL )
+        {
+            /* The callback did not return its result. Release the slot or
+             * drop the response if it has already been completed. */
+            pxMBDeferCurrent->xCancelled = TRUE;
+            MB_ATOMIC_CAS( &pxMBDeferCurrent->usState, usExpected, MB_DEFER_FREE, xSwapped );
+            ( void )xSwapped;
+        }
+    }
+    pucMBDeferFrame = NULL;
+    pxMBDeferCurrent = NULL;
+}
+
+BOOL
+xMBDeferPoll( UCHAR ** ppucFrame, UCHAR * pucUnit, USHORT * pusLength, eMBException * peException )
+{
+    eMBRegMapTable  eTable;
+    xMBDeferSlot   *pxSlot;
+    UCHAR          *pucPDU;
+    USHORT          usState;
+    USHORT          usExpected;
+    USHORT          usIdx;
+    ULONG           ulNow;
+    BOOL            xSend = FALSE;
+    BOOL            xSwapped;
+
+    ulNow = ulMBPortGetTimestampUs(  );
+    for( usIdx = 0; !xSend && ( usIdx < MB_DEFER_SLOTS ); usIdx++ )
+    {
+        pxSlot = &xMBDeferSlots[usIdx];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxSlot->usState, usState );
+        if( ( usState == MB_DEFER_PENDING ) &&
+            ( ( ULONG )( ulNow - pxSlot->ulTimeUs ) >= MB_DEFER_TIMEOUT_US ) )
+        {
+            usExpected = MB_DEFER_PENDING;
+            MB_ATOMIC_CAS( &pxSlot->usState, usExpected, MB_DEFER_COMPLETE, xSwapped );
+            if( xSwapped )
+            {
+                pxSlot->eException = ( eMBException )MB_DEFER_TIMEOUT_EXCEPTION;
+                pxSlot->ulTimeUs = ulNow;
+                usState = MB_DEFER_COMPLETE;
+            }
+        }
+        if( usState == MB_DEFER_COMPLETE )
+        {
+            if( !pxSlot->xCancelled )
+            {
+                pucPDU = &pxSlot->ucFrame[pxSlot->usHeadroom];
+                *pucUnit = pxSlot->ucUnit;
+                *peException = pxSlot->eException;
+                if( pxSlot->eException != MB_EX_NONE )
+                {
+                    /* Only the function code is required for the exception. */
+                    *pusLength = 1;
+                }
+                else if( pxSlot->xHandler )
+                {
+                    *pusLength = pxSlot->usNBytes;
+                }
+                else if( prvxMBDeferWriteTable( pucPDU[MB_PDU_FUNC_OFF], &eTable ) )
+                {
+                    *pusLength = MB_PDU_DEFER_WRITE_SIZE;
+                }
+                else
+                {
+                    *pusLength = pxSlot->usDataOff + pxSlot->usNBytes;
+                }
+                /* The slot is released by vMBDeferSent( ). */
+                *ppucFrame = &ucMBDeferTxBuf[MB_DEFER_HEADROOM];
+                memcpy( *ppucFrame - pxSlot->usHeadroom, pxSlot->ucFrame, pxSlot->usHeadroom + *pusLength );
+                pxMBDeferSending = pxSlot;
+                xSend = TRUE;
+            }
+            else
+            {
+                prvvMBDeferRelease( pxSlot );
+            }
+        }
+    }
+    return xSend;
+}
+
+void
+vMBDeferSent( BOOL xSent )
+{
+    xMBDeferSlot   *pxSlot = pxMBDeferSending;
+
+    if( pxSlot != NULL )
+    {
+        /* If the transport is busy the response is sent by a later call of
+         * xMBDeferPoll( ) unless the master has already given up. */
+        if( xSent ||
+            ( ( ULONG )( ulMBPortGetTimestampUs(  ) - pxSlot->ulTimeUs ) >= MB_DEFER_TIMEOUT_US ) )
+        {
+            prvvMBDeferRelease( pxSlot );
+        }
+        pxMBDeferSending = NULL;
+    }
+}
+
+static void
+prvvMBDeferRelease( xMBDeferSlot * pxSlot )
+{
+    eMBRegMapTable  eTable;
+    UCHAR          *pucPDU = &pxSlot->ucFrame[pxSlot->usHeadroom];
+
+    if( !pxSlot->xCancelled && !pxSlot->xHandler && ( pxSlot->eException == MB_EX_NONE ) &&
+        prvxMBDeferWriteTable( pucPDU[MB_PDU_FUNC_OFF], &eTable ) )
+    {
+        MB_HOOK_WRITE( eTable,
+                       ( USHORT )( ( ( pucPDU[MB_PDU_DEFER_ADDR_OFF] << 8 ) |
+                                     pucPDU[MB_PDU_DEFER_ADDR_OFF + 1] ) + 1 ),
+                       ( USHORT )( ( ( pucPDU[MB_PDU_FUNC_OFF] == MB_FUNC_WRITE_SINGLE_COIL ) ||
+                                     ( pucPDU[MB_PDU_FUNC_OFF] == MB_FUNC_WRITE_REGISTER ) ) ? 1 :
+                                   ( ( pucPDU[MB_PDU_DEFER_COUNT_OFF] << 8 ) |
+                                     pucPDU[MB_PDU_DEFER_COUNT_OFF + 1] ) ) );
+    }
+    MB_ATOMIC_STORE_RELEASE( &pxSlot->usState, MB_DEFER_FREE );
+}
+
+static xMBDeferSlot *
+prvpxMBDeferReserve( USHORT usDataOff, USHORT usNBytes, USHORT usCopy, BOOL xHandler )
+{
+    xMBDeferSlot   *pxSlot = NULL;
+    USHORT          usExpected;
+    USHORT          usIdx;
+    BOOL            xSwapped = FALSE;
+
+    /* A slot is claimed by moving it into the completing state. This keeps
+     * the completion functions and eMBPoll( ) away from it until the copy
+     * of the request is finished. */
+    for( usIdx = 0; !xSwapped && ( usIdx < MB_DEFER_SLOTS ); usIdx++ )
+    {
+        pxSlot = &xMBDeferSlots[usIdx];
+        usExpected = MB_DEFER_FREE;
+        MB_ATOMIC_CAS( &pxSlot->usState, usExpected, MB_DEFER_COMPLETING, xSwapped );
+    }
+    if( !xSwapped )
+    {
+        pxSlot = NULL;
+    }
+    else
+    {
+        /* Keep the header of the transport and the part of the PDU which
+         * does not change. */
+        ucMBDeferGeneration++;
+        pxSlot->usToken = ( USHORT )( ( ( USHORT )ucMBDeferGeneration << 8 ) |
+                                      ( USHORT )( pxSlot - &xMBDeferSlots[0] ) );
+        pxSlot->ucUnit = ucMBDeferUnit;
+        pxSlot->xCancelled = FALSE;
+        pxSlot->xHandler = xHandler;
+        pxSlot->eException = MB_EX_NONE;
+        pxSlot->ulTimeUs = ulMBPortGetTimestampUs(  );
+        pxSlot->usHeadroom = usMBDeferHeadroom;
+        pxSlot->usDataOff = usDataOff;
+        pxSlot->usNBytes = usNBytes;
+        memcpy( pxSlot->ucFrame, pucMBDeferFrame - usMBDeferHeadroom, usMBDeferHeadroom + usCopy );
+        pxMBDeferCurrent = pxSlot;
+        MB_ATOMIC_STORE_RELEASE( &pxSlot->usState, MB_DEFER_PENDING );
+    }
+    return pxSlot;
+}
+
+static xMBDeferSlot *
+prvpxMBDeferAcquire( USHORT usToken )
+{
+    xMBDeferSlot   *pxSlot = NULL;
+    USHORT          usExpected = MB_DEFER_PENDING;
+    BOOL            xSwapped = FALSE;
+
+    if( ( usToken & 0xFF ) < MB_DEFER_SLOTS )
+    {
+        pxSlot = &xMBDeferSlots[usToken & 0xFF];
+        MB_ATOMIC_CAS( &pxSlot->usState, usExpected, MB_DEFER_COMPLETING, xSwapped );
+        if( xSwapped && ( pxSlot->usToken != usToken ) )
+        {
+            /* The slot has been reused by another request. */
+            MB_ATOMIC_STORE_RELEASE( &pxSlot->usState, MB_DEFER_PENDING );
+            xSwapped = FALSE;
+        }
+    }
+    if( !xSwapped )
+    {
+        pxSlot = NULL;
+    }
+    return pxSlot;
+}
+
+static          BOOL
+prvxMBDeferWriteTable( UCHAR ucFunctionCode, eMBRegMapTable * peTable )
+{
+    BOOL            xIsWrite = TRUE;
+
+    switch ( ucFunctionCode )
+    {
+    case MB_FUNC_WRITE_SINGLE_COIL:
+    case MB_FUNC_WRITE_MULTIPLE_COILS:
+        *peTable = MB_REG_MAP_COILS;
+        break;
+    case MB_FUNC_WRITE_REGISTER:
+    case MB_FUNC_WRITE_MULTIPLE_REGISTERS:
+        *peTable = MB_REG_MAP_HOLDING;
+        break;
+    default:
+        xIsWrite = FALSE;
+        break;
+    }
+    return xIsWrite;
+}
+
+#endif
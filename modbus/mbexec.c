@@ -0,0 +1,380 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbport.h"
+#include "mbatomic.h"
+#include "mbregmap.h"
+#include "mbexec.h"
+
+#if MB_EXEC_ENABLED > 0
+
+#if ( MB_DEFER_ENABLED > 0 ) || ( MB_CACHE_ENABLED > 0 ) || ( MB_SUBSCRIBE_ENABLED > 0 )
+#error "MB_EXEC_ENABLED can not be combined with MB_DEFER_ENABLED, MB_CACHE_ENABLED or MB_SUBSCRIBE_ENABLED"
+#endif
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_PDU_EXEC_ADDR_OFF        ( MB_PDU_DATA_OFF )
+#define MB_PDU_EXEC_COUNT_OFF       ( MB_PDU_DATA_OFF + 2 )
+#define MB_PDU_EXEC_RW_ADDR_OFF     ( MB_PDU_DATA_OFF + 4 )
+#define MB_PDU_EXEC_RW_COUNT_OFF    ( MB_PDU_DATA_OFF + 6 )
+#define MB_PDU_EXEC_REQ_SIZE_MIN    ( 5 )
+#define MB_PDU_EXEC_RW_SIZE_MIN     ( 9 )
+
+/* Requests which find all jobs in use are answered with an exception. These
+ * responses are queued behind the jobs to keep the order of the responses. */
+#define MB_EXEC_QUEUE_SIZE          ( 2 * MB_EXEC_JOBS )
+
+#define MB_EXEC_QUEUED              ( 0 )
+#define MB_EXEC_RUNNING             ( 1 )
+#define MB_EXEC_DONE                ( 2 )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    USHORT          usState;
+    UCHAR           ucUnit;
+    BOOL            xInline;
+    BOOL            xWrite;
+    BOOL            xBusy;          /* Only a busy response. */
+    BOOL            xDiscard;       /* Flushed. The response is not sent. */
+    eMBRegMapTable  eTable;
+    ULONG           ulFirst;        /* Range accessed by the request. */
+    ULONG           ulEnd;
+    pxMBFunctionHandler pxHandler;
+    eMBException    eException;
+    USHORT          usHeadroom;
+    USHORT          usLength;
+    UCHAR           ucFrame[MB_EXEC_HEADROOM + MB_PDU_SIZE_MAX];
+} xMBExecJob;
+
+/* ----------------------- Static variables ---------------------------------*/
+/* The jobs form a ring in the order of the requests. Only the state is
+ * shared with the worker threads. */
+static xMBExecJob xMBExecJobs[MB_EXEC_QUEUE_SIZE];
+static USHORT   usMBExecHead;
+static USHORT   usMBExecCount;
+static USHORT   usMBExecBusy;   /* Jobs which are only a busy response. */
+
+/* The responses are sent from a buffer of their own because the buffer of
+ * the transport may already hold the next request. */
+static UCHAR    ucMBExecTxBuf[MB_EXEC_HEADROOM + MB_PDU_SIZE_MAX + MB_EXEC_TAILROOM];
+
+/* ----------------------- Static functions ---------------------------------*/
+static void     prvvMBExecSetRange( xMBExecJob * pxJob );
+static BOOL     prvxMBExecBlocked( USHORT usPos );
+static void     prvvMBExecSchedule( void );
+static void     prvvMBExecDiscard( void );
+
+/* ----------------------- Start implementation -----------------------------*/
+void
+vMBExecSubmit( UCHAR ucUnit, UCHAR * pucFrame, USHORT usLength, USHORT usHeadroom,
+               pxMBFunctionHandler pxHandler )
+{
+    xMBExecJob     *pxJob;
+
+    /* If even the queue is full the request is dropped. The master repeats
+     * it after its timeout. */
+    if( usMBExecCount < MB_EXEC_QUEUE_SIZE )
+    {
+        pxJob = &xMBExecJobs[( usMBExecHead + usMBExecCount ) % MB_EXEC_QUEUE_SIZE];
+        pxJob->ucUnit = ucUnit;
+        pxJob->pxHandler = pxHandler;
+        pxJob->usHeadroom = usHeadroom;
+        pxJob->xDiscard = FALSE;
+        if( ( ( usMBExecCount - usMBExecBusy ) < MB_EXEC_JOBS ) && ( usLength <= MB_PDU_SIZE_MAX ) )
+        {
+            pxJob->xBusy = FALSE;
+            pxJob->eException = MB_EX_NONE;
+            pxJob->usLength = usLength;
+            memcpy( pxJob->ucFrame, pucFrame - usHeadroom, usHeadroom + usLength );
+            prvvMBExecSetRange( pxJob );
+            pxJob->usState = MB_EXEC_QUEUED;
+        }
+        else
+        {
+            /* Only the function code is required for the exception. */
+            pxJob->xBusy = TRUE;
+            pxJob->eException = MB_EX_SLAVE_BUSY;
+            pxJob->usLength = 1;
+            memcpy( pxJob->ucFrame, pucFrame - usHeadroom, usHeadroom + 1 );
+            pxJob->usState = MB_EXEC_DONE;
+            usMBExecBusy++;
+        }
+        usMBExecCount++;
+        prvvMBExecSchedule(  );
+    }
+}
+
+BOOL
+xMBExecPoll( UCHAR ** ppucFrame, UCHAR * pucUnit, USHORT * pusLength, eMBException * peException )
+{
+    xMBExecJob     *pxJob;
+    USHORT          usState = MB_EXEC_QUEUED;
+    BOOL            xSend = FALSE;
+
+    prvvMBExecDiscard(  );
+    prvvMBExecSchedule(  );
+    pxJob = &xMBExecJobs[usMBExecHead];
+    if( usMBExecCount > 0 )
+    {
+        MB_ATOMIC_LOAD_ACQUIRE( &pxJob->usState, usState );
+    }
+    if( usState == MB_EXEC_DONE )
+    {
+        *pucUnit = pxJob->ucUnit;
+        *peException = pxJob->eException;
+        *pusLength = pxJob->usLength;
+        *ppucFrame = &ucMBExecTxBuf[MB_EXEC_HEADROOM];
+        memcpy( *ppucFrame - pxJob->usHeadroom, pxJob->ucFrame,
+                pxJob->usHeadroom + ( ( pxJob->eException != MB_EX_NONE ) ? 1 : pxJob->usLength ) );
+        xSend = TRUE;
+    }
+    return xSend;
+}
+
+void
+vMBExecSent( BOOL xSent )
+{
+    /* Otherwise the job stays at the head and is sent by a later call of
+     * xMBExecPoll( ). */
+    if( xSent && ( usMBExecCount > 0 ) )
+    {
+        if( xMBExecJobs[usMBExecHead].xBusy )
+        {
+            usMBExecBusy--;
+        }
+        usMBExecHead = ( USHORT )( ( usMBExecHead + 1 ) % MB_EXEC_QUEUE_SIZE );
+        usMBExecCount--;
+    }
+}
+
+void
+vMBExecFlush( void )
+{
+    xMBExecJob     *pxJob;
+    USHORT          usState;
+    USHORT          usPos;
+
+    for( usPos = 0; usPos < usMBExecCount; usPos++ )
+    {
+        pxJob = &xMBExecJobs[( usMBExecHead + usPos ) % MB_EXEC_QUEUE_SIZE];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxJob->usState, usState );
+        if( usState == MB_EXEC_QUEUED )
+        {
+            /* Not started yet. Queued jobs are only accessed by this thread. */
+            pxJob->usState = MB_EXEC_DONE;
+        }
+        pxJob->xDiscard = TRUE;
+    }
+    /* Running jobs keep their place and block later requests until the
+     * worker is finished with them. */
+    prvvMBExecDiscard(  );
+}
+
+void
+vMBExecRun( void *pvJob )
+{
+    xMBExecJob     *pxJob = ( xMBExecJob * ) pvJob;
+
+    if( pxJob->pxHandler != NULL )
+    {
+        pxJob->eException = pxJob->pxHandler( &pxJob->ucFrame[pxJob->usHeadroom], &pxJob->usLength );
+    }
+    else
+    {
+        pxJob->eException = MB_EX_ILLEGAL_FUNCTION;
+    }
+    MB_ATOMIC_STORE_RELEASE( &pxJob->usState, MB_EXEC_DONE );
+}
+
+static void
+prvvMBExecSchedule( void )
+{
+    xMBExecJob     *pxJob;
+    USHORT          usState;
+    USHORT          usPos;
+
+    for( usPos = 0; usPos < usMBExecCount; usPos++ )
+    {
+        pxJob = &xMBExecJobs[( usMBExecHead + usPos ) % MB_EXEC_QUEUE_SIZE];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxJob->usState, usState );
+        if( ( usState == MB_EXEC_QUEUED ) && !prvxMBExecBlocked( usPos ) )
+        {
+            MB_ATOMIC_STORE_RELEASE( &pxJob->usState, MB_EXEC_RUNNING );
+            if( pxJob->xInline || !xMBPortExecSubmit( pxJob ) )
+            {
+                vMBExecRun( pxJob );
+            }
+        }
+    }
+}
+
+static void
+prvvMBExecDiscard( void )
+{
+    USHORT          usState = MB_EXEC_DONE;
+
+    while( ( usMBExecCount > 0 ) && ( usState == MB_EXEC_DONE ) )
+    {
+        MB_ATOMIC_LOAD_ACQUIRE( &xMBExecJobs[usMBExecHead].usState, usState );
+        if( !xMBExecJobs[usMBExecHead].xDiscard )
+        {
+            usState = MB_EXEC_QUEUED;
+        }
+        else if( usState == MB_EXEC_DONE )
+        {
+            vMBExecSent( TRUE );
+        }
+    }
+}
+
+static          BOOL
+prvxMBExecBlocked( USHORT usPos )
+{
+    xMBExecJob     *pxJob = &xMBExecJobs[( usMBExecHead + usPos ) % MB_EXEC_QUEUE_SIZE];
+    xMBExecJob     *pxPrev;
+    USHORT          usPrevPos;
+    USHORT          usState;
+    BOOL            xBlocked = FALSE;
+
+    for( usPrevPos = 0; !xBlocked && ( usPrevPos < usPos ); usPrevPos++ )
+    {
+        pxPrev = &xMBExecJobs[( usMBExecHead + usPrevPos ) % MB_EXEC_QUEUE_SIZE];
+        MB_ATOMIC_LOAD_ACQUIRE( &pxPrev->usState, usState );
+        if( usState != MB_EXEC_DONE )
+        {
+            xBlocked = pxJob->xInline || pxPrev->xInline ||
+                ( ( pxJob->xWrite || pxPrev->xWrite ) && ( pxJob->eTable == pxPrev->eTable ) &&
+                  ( pxJob->ulFirst < pxPrev->ulEnd ) && ( pxPrev->ulFirst < pxJob->ulEnd ) );
+        }
+    }
+    return xBlocked;
+}
+
+static void
+prvvMBExecSetRange( xMBExecJob * pxJob )
+{
+    UCHAR          *pucPDU = &pxJob->ucFrame[pxJob->usHeadroom];
+    ULONG           ulRWFirst;
+
+    pxJob->xInline = FALSE;
+    pxJob->xWrite = TRUE;
+    pxJob->ulFirst = ( ULONG )( ( pucPDU[MB_PDU_EXEC_ADDR_OFF] << 8 ) | pucPDU[MB_PDU_EXEC_ADDR_OFF + 1] );
+    pxJob->ulEnd = pxJob->ulFirst + 1;
+    switch ( pucPDU[MB_PDU_FUNC_OFF] )
+    {
+    case MB_FUNC_READ_COILS:
+        pxJob->eTable = MB_REG_MAP_COILS;
+        pxJob->xWrite = FALSE;
+        break;
+    case MB_FUNC_READ_DISCRETE_INPUTS:
+        pxJob->eTable = MB_REG_MAP_DISCRETE;
+        pxJob->xWrite = FALSE;
+        break;
+    case MB_FUNC_READ_HOLDING_REGISTER:
+        pxJob->eTable = MB_REG_MAP_HOLDING;
+        pxJob->xWrite = FALSE;
+        break;
+    case MB_FUNC_READ_INPUT_REGISTER:
+        pxJob->eTable = MB_REG_MAP_INPUT;
+        pxJob->xWrite = FALSE;
+        break;
+    case MB_FUNC_WRITE_SINGLE_COIL:
+    case MB_FUNC_WRITE_MULTIPLE_COILS:
+        pxJob->eTable = MB_REG_MAP_COILS;
+        break;
+    case MB_FUNC_WRITE_REGISTER:
+    case MB_FUNC_WRITE_MULTIPLE_REGISTERS:
+    case MB_FUNC_MASK_WRITE_REGISTER:
+    case MB_FUNC_READWRITE_MULTIPLE_REGISTERS:
+        pxJob->eTable = MB_REG_MAP_HOLDING;
+        break;
+    default:
+        pxJob->xInline = TRUE;
+        break;
+    }
+
+    if( pxJob->usLength < MB_PDU_EXEC_REQ_SIZE_MIN )
+    {
+        /* Leave invalid requests to the function handler. */
+        pxJob->xInline = TRUE;
+    }
+    else if( !pxJob->xInline )
+    {
+        switch ( pucPDU[MB_PDU_FUNC_OFF] )
+        {
+        case MB_FUNC_WRITE_SINGLE_COIL:
+        case MB_FUNC_WRITE_REGISTER:
+        case MB_FUNC_MASK_WRITE_REGISTER:
+            break;
+        case MB_FUNC_READWRITE_MULTIPLE_REGISTERS:
+            if( pxJob->usLength < MB_PDU_EXEC_RW_SIZE_MIN )
+            {
+                pxJob->xInline = TRUE;
+            }
+            else
+            {
+                /* The range covers the registers which are read and written. */
+                pxJob->ulEnd = pxJob->ulFirst +
+                    ( ULONG )( ( pucPDU[MB_PDU_EXEC_COUNT_OFF] << 8 ) | pucPDU[MB_PDU_EXEC_COUNT_OFF + 1] );
+                ulRWFirst = ( ULONG )( ( pucPDU[MB_PDU_EXEC_RW_ADDR_OFF] << 8 ) |
+                                       pucPDU[MB_PDU_EXEC_RW_ADDR_OFF + 1] );
+                if( ulRWFirst < pxJob->ulFirst )
+                {
+                    pxJob->ulFirst = ulRWFirst;
+                }
+                ulRWFirst += ( ULONG )( ( pucPDU[MB_PDU_EXEC_RW_COUNT_OFF] << 8 ) |
+                                        pucPDU[MB_PDU_EXEC_RW_COUNT_OFF + 1] );
+                if( ulRWFirst > pxJob->ulEnd )
+                {
+                    pxJob->ulEnd = ulRWFirst;
+                }
+            }
+            break;
+        default:
+            pxJob->ulEnd = pxJob->ulFirst +
+                ( ULONG )( ( pucPDU[MB_PDU_EXEC_COUNT_OFF] << 8 ) | pucPDU[MB_PDU_EXEC_COUNT_OFF + 1] );
+            break;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006-2018 Christian Walter <cwalter@embedded-solutions.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbstats.h"
+
+#if MB_STATS_ENABLED > 0
+
+/* ----------------------- Static variables ---------------------------------*/
+volatile xMBStats xMBStatsCounters;
+
+#if MB_STATS_LATENCY_ENABLED > 0
+static ULONG    ulFrameReceivedUs;
+#endif
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBGetStats( xMBStats * pxStats )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( pxStats == NULL )
+    {
+        eStatus = MB_EINVAL;
+    }
+    else
+    {
+        /* Each counter has a single writer and is copied as a whole. We
+         * therefore do not need to lock out the protocol stack. */
+        memcpy( pxStats, ( const void * )&xMBStatsCounters, sizeof( xMBStats ) );
+    }
+    return eStatus;
+}
+
+void
+vMBStatsException( UCHAR ucFunctionCode, eMBException eException )
+{
+    xMBStatsCounters.ulExceptions[ucFunctionCode & 0x7F]++;
+    if( ( USHORT )eException < MB_STATS_EXCEPTION_CODES )
+    {
+        xMBStatsCounters.ulExceptionCodes[eException]++;
+    }
+}
+
+#if MB_STATS_LATENCY_ENABLED > 0
+void
+vMBStatsFrameReceived( void )
+{
+    ulFrameReceivedUs = ulMBPortGetTimestampUs(  );
+}
+
+void
+vMBStatsSendStarted( void )
+{
+    ULONG           ulLatencyUs;
+    USHORT          usBucket = 0;
+
+    /* Unsigned arithmetic takes care of a wrap around of the timestamp. */
+    ulLatencyUs = ulMBPortGetTimestampUs(  ) - ulFrameReceivedUs;
+
+    /* The bucket is given by the position of the highest bit set. */
+    while( ( ulLatencyUs > 1 ) && ( usBucket < ( MB_STATS_LATENCY_BUCKETS - 1 ) ) )
+    {
+        ulLatencyUs >>= 1;
+        usBucket++;
+    }
+    xMBStatsCounters.ulLatency[usBucket]++;
+}
+#endif
+
+#endif
@@ -30,6 +30,13 @@
 #ifndef _MB_CRC_H
 #define _MB_CRC_H
 
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+
 USHORT          usMBCRC16( const UCHAR * pucFrame, USHORT usLen );
 
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
 #endif
@@ -41,6 +41,8 @@
 
 #include "mbcrc.h"
 #include "mbport.h"
+#include "mbstats.h"
+#include "mbdiag.h"
 
 /* ----------------------- Defines ------------------------------------------*/
 #define MB_SER_PDU_SIZE_MIN     4       /*!< Minimum size of a Modbus RTU frame. */
@@ -180,6 +182,8 @@ eMBRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
         }
         else
         {
+            MB_STATS_INC( ulChecksumErrors );
+            MB_DIAG_INC( MB_DIAG_CNT_BUS_COMM_ERROR );
             eStatus = MB_EIO;
         }
     }
@@ -202,6 +206,8 @@ eMBRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
     }
     else
     {
+        MB_STATS_INC( ulChecksumErrors );
+        MB_DIAG_INC( MB_DIAG_CNT_BUS_COMM_ERROR );
         eStatus = MB_EIO;
     }
 #endif
@@ -235,22 +241,8 @@ eMBRTUSend( UCHAR ucSlaveAddress, const UCHAR * pucFrame, USHORT usLength )
         /* Calculate CRC16 checksum for Modbus-Serial-Line-PDU. */
         usCRC16 = usMBCRC16( ( UCHAR * ) pucSndBufferCur, usSndBufferCount );
         
-#ifdef STM32_CMAKE // work around nasty gcc compiler bug
-        volatile UCHAR* destPtr;
-        
-        // Get the correct address of ucRTUBuf
-        __asm__ volatile ("ldr %0, =ucRTUBuf" : "=r" (destPtr));
-        
-        // Store the CRC bytes at the correct positions
-        *(destPtr + usSndBufferCount) = ( UCHAR )( usCRC16 & 0xFF );
-        usSndBufferCount++;
-        
-        *(destPtr + usSndBufferCount) = ( UCHAR )( usCRC16 >> 8 );
-        usSndBufferCount++;
-#else
-        ucRTUBuf[usSndBufferCount++] = ( UCHAR )( usCRC16 & 0xFF );
-        ucRTUBuf[usSndBufferCount++] = ( UCHAR )( usCRC16 >> 8 );
-#endif
+        pucSndBufferCur[usSndBufferCount++] = ( UCHAR )( usCRC16 & 0xFF );
+        pucSndBufferCur[usSndBufferCount++] = ( UCHAR )( usCRC16 >> 8 );
 
         /* Activate the transmitter. */
         eSndState = STATE_TX_XMIT;
@@ -341,6 +333,8 @@ xMBRTUReceiveFSM( void )
         }
         else
         {
+            MB_STATS_INC( ulOverruns );
+            MB_DIAG_INC( MB_DIAG_CNT_BUS_CHAR_OVERRUN );
             eRcvState = STATE_RX_ERROR;
         }
         vMBPortTimersEnable(  );